@@ -0,0 +1,104 @@
+/*
+ * Benchmark of Image::at()
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <elm/io.h>
+#include <gel++/Image.h>
+
+using namespace elm;
+using namespace gel;
+
+// size of the benchmarked segments
+static const size_t seg_size = 4096;
+
+// number of look-ups per measure
+static const int lookups = 1 << 22;
+
+typedef std::chrono::steady_clock clock_t_;
+
+// linear look-up (as performed before the sorted table)
+static ImageSegment *linear(Image& im, address_t a) {
+	for(auto s: im.segments())
+		if(s->range().contains(a))
+			return s;
+	return nullptr;
+}
+
+// run the look-ups and return the number of look-ups per second
+template <class F>
+static double measure(const Vector<address_t>& addrs, F f) {
+	int found = 0;
+	auto start = clock_t_::now();
+	for(int i = 0; i < lookups; i++)
+		if(f(addrs[i & (addrs.count() - 1)]) != nullptr)
+			found++;
+	std::chrono::duration<double> d = clock_t_::now() - start;
+	if(found != lookups)
+		cerr << "ERROR: " << (lookups - found) << " look-ups failed\n";
+	return lookups / d.count();
+}
+
+int main(int argc, char **argv) {
+	static t::uint8 mem[seg_size];
+	std::mt19937 gen(0);
+	cout << "segments\tlinear/s\tsequential/s\trandom/s\n";
+
+	for(int n = 1; n <= 4096; n *= 4) {
+
+		// build the image (segments separated by holes, added in shuffled order)
+		Image im(nullptr);
+		Vector<int> order;
+		for(int i = 0; i < n; i++)
+			order.add(i);
+		std::shuffle(&order[0], &order[0] + n, gen);
+		Vector<ImageSegment *> segs;
+		for(int i = 0; i < n; i++) {
+			auto s = new ImageSegment(Buffer(nullptr, mem, seg_size), 0x10000 + order[i] * 2 * seg_size, ImageSegment::READABLE);
+			segs.add(s);
+			im.add(s);
+		}
+
+		// sequential addresses: word by word, segment after segment
+		Vector<address_t> seq;
+		for(int i = 0; i < 1 << 16; i++)
+			seq.add(0x10000 + (i * 4 / seg_size % n) * 2 * seg_size + i * 4 % seg_size);
+
+		// random addresses
+		Vector<address_t> rnd;
+		std::uniform_int_distribution<int> sdist(0, n - 1), odist(0, seg_size - 1);
+		for(int i = 0; i < 1 << 16; i++)
+			rnd.add(0x10000 + sdist(gen) * 2 * seg_size + odist(gen));
+
+		double lin = n <= 256 ? measure(rnd, [&](address_t a) { return linear(im, a); }) : 0;
+		double sq = measure(seq, [&](address_t a) { return im.at(a); });
+		double rd = measure(rnd, [&](address_t a) { return im.at(a); });
+		cout << n << '\t';
+		if(lin != 0)
+			cout << t::uint64(lin);
+		else
+			cout << '-';
+		cout << '\t' << t::uint64(sq) << '\t' << t::uint64(rd) << io::endl;
+
+		for(auto s: segs)
+			delete s;
+	}
+	return 0;
+}
@@ -75,7 +75,7 @@ public:
 					if(!no_content) {
 						int p = 15;
 						address_t a = seg->base();
-						for(Cursor c(seg->buffer()); c.avail(1); ) {
+						for(Cursor c(static_cast<const ImageSegment *>(seg)->buffer()); c.avail(1); ) {
 
 							// display address
 							if(p < 15)
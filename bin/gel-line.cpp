@@ -22,6 +22,7 @@
 #include <elm/data/FragTable.h>
 #include <elm/data/HashMap.h>
 
+#include <gel++/CompactLineTable.h>
 #include <gel++/elf/DebugLine.h>
 
 using namespace elm;
@@ -37,13 +38,15 @@ public:
 			.free_argument("<file path>")
 			.help()),
 		list_files(option::Switch::Make(*this).cmd("-l").help("display file/line to code [default]")),
-		list_code(option::Switch::Make(*this).cmd("-c").help("display code to file/line"))
+		list_code(option::Switch::Make(*this).cmd("-c").help("display code to file/line")),
+		compact(option::Switch::Make(*this).cmd("-m").help("store the lines in compact form")),
+		stats(option::Switch::Make(*this).cmd("-s").help("display the memory used by the lines"))
 	{ }
 
 	void run() override {
 		for(int i = 0; i < args.count(); i++)
 			try {
-				auto f = gel::Manager::open(args[i]);
+				auto f = gel::Manager::open(args[i], compact ? gel::Manager::COMPACT_LINES : 0);
 				auto dl = f->debugLines();
 				ASSERT(dl != nullptr);
 				
@@ -54,7 +57,9 @@ public:
 					addr_fmt.width(16);
 
 				// perform the action
-				if(list_code)
+				if(stats)
+					displayStats(dl);
+				else if(list_code)
 					listCode(dl);
 				else
 					listFiles(dl);
@@ -75,57 +80,64 @@ private:
 
 	void listFiles(DebugLine *dl) {
 		for(auto file: dl->files()) {
+			const auto& ranges = file->ranges();
+			if(ranges.count() == 0)
+				continue;
+			auto f = io::IntFormat().right().pad(' ').width(log10(max(ranges.top().line(), 1)) + 1);
+			for(const auto& r: ranges)
+				cout << file->path() << ":" << f(r.line())
+					 << "\t" << addr_fmt(r.base())
+					 << "-"  << addr_fmt(r.top()) << io::endl;
+		}
+	}
 
-			// collect addresses
-			HashMap<int, List<Pair<address_t, address_t> > *> addrs;
-			int min = type_info<int>::max, max = 0;
-			for(auto cu: file->units()) {
+	void listCode(DebugLine *dl) {
+		for(auto cu: dl->units()) {
+			if(!dl->isCompact()) {
 				const auto& lines = cu->lines();
 				for(int i = 0; i < lines.count() - 1; i++)
-					if(file == lines[i].file()) {
-						auto l = addrs.get(lines[i].line(), nullptr);
-						if(l == nullptr) {
-							l = new List<Pair<address_t, address_t> >();
-							addrs.put(lines[i].line(), l);
-						}
-						l->add(pair(lines[i].addr(), lines[i + 1].addr()));
-						if(lines[i].line() < min)
-							min = lines[i].line();
-						else if(lines[i].line() > max)
-							max = lines[i].line();
-					}
-			}
-
-			// display the addresses
-			if(min <= max) {
-				auto f = io::IntFormat().right().pad(' ').width(log10(max) + 1);
-				for(int i = min; i <= max; i++)
-					if(addrs.hasKey(i)) {
-						auto l = addrs.get(i, nullptr);
-						if(l != nullptr)
-							for(auto a: *l)
-								cout << file->path() << ":" << f(i)
-									 << "\t" << addr_fmt(a.fst)
-									 << "-"  << addr_fmt(a.snd) << io::endl;
-					}
+					if(!(lines[i].flags() & DebugLine::LineNumber::END_SEQUENCE))
+						displayLine(lines[i]);
+				continue;
 			}
-
-			// clean all
-			for(auto l: addrs)
-				delete l;
+			auto compact = cu->compactLines();
+			if(compact != nullptr)
+				for(CompactLineTable::Iter i(*compact); !i.ended(); i.next()) {
+					auto l = i.item();
+					if(!(l.flags() & DebugLine::LineNumber::END_SEQUENCE))
+						displayLine(l);
+				}
 		}
 	}
 
-	void listCode(DebugLine *dl) {
+	void displayLine(const DebugLine::LineNumber& l) {
+		cout << addr_fmt(l.addr()) << "\t" << l.file()->path() << ":" << l.line() << io::endl;
+	}
+
+	void displayStats(DebugLine *dl) {
+		size_t rows = 0, size = 0;
 		for(auto cu: dl->units()) {
-			const auto& lines = cu->lines();
-			for(int i = 0; i < lines.count() - 1; i++)
-				cout << addr_fmt(lines[i].addr()) << "\t" << lines[i].file()->path() << ":" << lines[i].line() << io::endl;
+			if(!dl->isCompact()) {
+				rows += cu->lines().count();
+				size += cu->lines().count() * sizeof(DebugLine::LineNumber);
+				continue;
+			}
+			auto compact = cu->compactLines();
+			if(compact != nullptr) {
+				rows += compact->count();
+				size += compact->footprint();
+			}
 		}
+		cout << "units: " << dl->units().count() << io::endl;
+		cout << "rows: " << rows << io::endl;
+		cout << "line memory: " << size << " bytes";
+		if(rows != 0)
+			cout << " (" << (double(size) / rows) << " bytes/row)";
+		cout << io::endl;
 	}
 
 	io::IntFormat addr_fmt = io::IntFormat().pad('0').hex().right();
-	option::Switch list_files, list_code;
+	option::Switch list_files, list_code, compact, stats;
 	Vector<string> args;
 };
 
@@ -49,8 +49,9 @@ public:
 					cout << "SECTION " << sect->name() << io::endl;
 					cout << "st_value st_size  binding type    st_shndx         name\n";
 				}
-				for(auto s: f->symbols()) {
-					auto sym = static_cast<elf::Symbol *>(s);
+				auto& syms = static_cast<const elf::SymbolTable&>(f->symbols());
+				for(int j = 0; j < syms.length(); j++) {
+					auto sym = &syms.entry(j);
 					if(only_functions) {
 						if(sym->type() == Symbol::FUNC && sym->size() > 0)
 							cout << sym->name() << " " << io::endl;
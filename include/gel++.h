@@ -31,19 +31,52 @@ namespace gel {
 using namespace elm;
 
 class File;
+class Source;
 namespace elf { class File; }
 namespace pecoff { class File; }
 
+typedef enum {
+	unknown_format,
+	elf_format,
+	pecoff_format,
+	coff_format
+} format_t;
+
+class Identity {
+public:
+	Identity();
+	format_t format;
+	address_type_t address_type;
+	int machine;
+	File::type_t type;
+	bool big_endian;
+};
+
 class Manager: public ErrorBase {
 public:
-	inline static File *open(sys::Path path) { return DEFAULT.openFile(path); }
-	inline static elf::File *openELF(sys::Path path) { return DEFAULT.openELFFile(path); }
+	typedef t::uint32 flags_t;
+	static const flags_t
+		MAPPED = 0x01,
+		CONCURRENT = 0x02,
+		HEADERS_ONLY = 0x04,
+		COMPACT_LINES = 0x08,
+		LAZY_LINES = 0x10;
+
+	inline static File *open(sys::Path path, flags_t flags = 0) { return DEFAULT.openFile(path, flags); }
+	inline static elf::File *openELF(sys::Path path, flags_t flags = 0) { return DEFAULT.openELFFile(path, flags); }
 
 	static Manager DEFAULT;
-	File *openFile(sys::Path path);
-	elf::File *openELFFile(sys::Path path);
+	File *openFile(sys::Path path, flags_t flags = 0);
+	File *openMemory(const void *data, size_t size, sys::Path name = "");
+	Identity identify(sys::Path path);
+	elf::File *openELFFile(sys::Path path, flags_t flags = 0);
 	elf::File *openELFFile(sys::Path path, io::RandomAccessStream *stream);
+	elf::File *openELFFile(sys::Path path, Source *source);
 	pecoff::File *openPECOFFFile(sys::Path path, io::RandomAccessStream *stream);
+
+private:
+	Source *openSource(sys::Path path, flags_t flags);
+	elf::File *openELFFile(sys::Path path, Source *source, flags_t flags);
 	
 };
 
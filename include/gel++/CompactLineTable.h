@@ -0,0 +1,106 @@
+/*
+ * GEL++ CompactLineTable class interface
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef GELPP_COMPACT_LINE_TABLE_H_
+#define GELPP_COMPACT_LINE_TABLE_H_
+
+#include <gel++/DebugLine.h>
+
+namespace gel {
+
+class CompactLineTable {
+	typedef struct {
+		address_t addr, top, low;
+		t::uint32 offset, file;
+		t::int32 line, col;
+	} anchor_t;
+
+	typedef struct {
+		address_t addr;
+		t::uint32 file;
+		t::int32 line, col;
+		t::uint32 flags;
+		t::uint8 isa, disc, opi;
+	} row_t;
+
+public:
+	typedef DebugLine::LineNumber LineNumber;
+	static const int block_size = 128;
+
+	class Builder {
+	public:
+		Builder(CompactLineTable& table);
+		void add(const LineNumber& line);
+		void finish();
+	private:
+		typedef struct {
+			int b, e;
+		} seq_t;
+		void encode(const row_t& r);
+		t::uint32 fileIndex(DebugLine::File *file);
+		CompactLineTable& tab;
+		Vector<row_t> rows;
+		Vector<t::uint8> bytes;
+		Vector<seq_t> seqs;
+		int seq_start;
+		HashMap<const DebugLine::File *, int> files;
+		Vector<Pair<address_t, address_t> > cover;
+		row_t prev;
+		bool pending;
+		int pending_block;
+	};
+
+	class Iter: public PreIterator<Iter, LineNumber> {
+	public:
+		Iter(const CompactLineTable& table);
+		inline bool ended() const { return _i >= _t._count; }
+		inline LineNumber item() const { return _t.make(_r); }
+		void next();
+		inline bool equals(const Iter& i) const { return &_t == &i._t && _i == i._i; }
+	private:
+		const CompactLineTable& _t;
+		int _i;
+		const t::uint8 *_p;
+		row_t _r;
+	};
+
+	CompactLineTable();
+	~CompactLineTable();
+
+	inline int count() const { return _count; }
+	LineNumber get(int i) const;
+	inline LineNumber operator[](int i) const { return get(i); }
+	bool lineAt(address_t addr, LineNumber& line) const;
+	size_t footprint() const;
+
+private:
+	void decode(const t::uint8 *&p, row_t& row) const;
+	LineNumber make(const row_t& row) const;
+	CompactLineTable(const CompactLineTable&);
+	CompactLineTable& operator=(const CompactLineTable&);
+
+	int _count;
+	Vector<DebugLine::File *> _files;
+	Vector<anchor_t> _anchors;
+	t::uint8 *_bytes;
+	size_t _size;
+};
+
+}	// gel
+
+#endif	// GELPP_COMPACT_LINE_TABLE_H_
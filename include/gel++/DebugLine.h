@@ -19,6 +19,8 @@
 #ifndef GELPP_DEBUG_LINE_H
 #define GELPP_DEBUG_LINE_H
 
+#include <atomic>
+#include <mutex>
 #include <elm/data/List.h>
 #include <elm/data/FragTable.h>
 #include <elm/data/HashMap.h>
@@ -28,31 +30,53 @@ namespace gel {
 
 using namespace elm;
 
+class CompactLineTable;
+
 class DebugLine {
 public:
 
 	class CompilationUnit;
 	class LineNumber;
 
+	class LineRange {
+	public:
+		inline LineRange(): _line(0), _col(0), _base(0), _top(0) { }
+		inline LineRange(int line, int col, address_t base, address_t top)
+			: _line(line), _col(col), _base(base), _top(top) { }
+		inline int line() const { return _line; }
+		inline int col() const { return _col; }
+		inline address_t base() const { return _base; }
+		inline address_t top() const { return _top; }
+	private:
+		int _line, _col;
+		address_t _base, _top;
+	};
+
 	class File {
 		friend class CompilationUnit;
 		friend class DebugLine;
 	public:
-		inline File(): _date(0), _size(0) { }
+		inline File(): _date(0), _size(0), _ranges(nullptr) { }
 		inline File(sys::Path path, t::uint64 date = 0, size_t size = 0):
-			_path(path), _date(date), _size(size) { }
+			_path(path), _date(date), _size(size), _ranges(nullptr) { }
+		~File();
 
 		inline const sys::Path& path() const { return _path; }
 		inline t::uint64 date() const { return _date; }
 		inline size_t size() const { return _size; }
 		inline const List<CompilationUnit *>& units() const { return _units; }
 		void find(int line, Vector<Pair<address_t, address_t> >& addrs) const;
+		void find(int line, int col, Vector<Pair<address_t, address_t> >& addrs) const;
+		void find(const Vector<int>& lines, Vector<Pair<int, int> >& spans) const;
+		const Vector<LineRange>& ranges() const;
 
 	private:
+		int lowerBound(int b, int line, int col) const;
 		sys::Path _path;
 		t::uint64 _date;
 		size_t _size;
 		List<CompilationUnit *> _units;
+		mutable std::atomic<Vector<LineRange> *> _ranges;
 	};
 
 	class LineNumber {
@@ -61,7 +85,8 @@ public:
 			IS_STMT			= 1 << 0,
 			BASIC_BLOCK		= 1 << 1,
 			PROLOGUE_END	= 1 << 2,
-			EPILOGUE_BEGIN	= 1 << 3;
+			EPILOGUE_BEGIN	= 1 << 3,
+			END_SEQUENCE	= 1 << 4;
 
 		inline LineNumber()
 			: _file(nullptr), _line(0), _col(0), _flags(0), _addr(0), _isa(0),
@@ -87,37 +112,114 @@ public:
 		t::uint8 _isa, _disc, _opi;
 	};
 
+private:
+	typedef struct {
+		address_t lo, hi, top;
+		const LineNumber *line;
+	} line_entry_t;
+	typedef Vector<line_entry_t> line_index_t;
+
+	typedef struct {
+		address_t lo, hi, top;
+		const CompilationUnit *unit;
+	} unit_entry_t;
+	typedef Vector<unit_entry_t> unit_index_t;
+
+	typedef enum {
+		NONE = 0,
+		BOUND = 1,
+		LOADED = 2,
+		INDEXED = 3
+	} state_t;
+
+public:
+	class LineIter;
+
 	class CompilationUnit {
 		friend class DebugLine;
+		friend class LineIter;
 	public:
-		const FragTable<LineNumber>& lines() const { return _lines; }
+		CompilationUnit();
+		virtual ~CompilationUnit();
+		const FragTable<LineNumber>& lines() const;
+		const CompactLineTable *compactLines() const;
 		const Vector<File *>& files() const { return _files; }
 		void add(const LineNumber& num);
+		void add(CompactLineTable *lines);
 		void add(File *file);
+		void addRange(address_t base, address_t top);
+		const Vector<Pair<address_t, address_t> >& ranges() const;
 		address_t baseAddress() const;
 		address_t topAddress() const;
 		inline size_t size() const { return topAddress() - baseAddress(); }
 		const LineNumber *lineAt(address_t addr) const;
+		bool lineAt(address_t addr, LineNumber& line) const;
+		inline bool isLoaded() const { return _state.load(std::memory_order_acquire) >= LOADED; }
 	private:
-		Vector<File *> _files;
+		const line_index_t& index() const;
+		void reset(bool ranges);
+		void buildIndex();
+		DebugLine *_dl;
+		Vector<File *> _files, _defined;
 		FragTable<LineNumber> _lines;
+		CompactLineTable *_compact;
+		Vector<Pair<address_t, address_t> > _ranges;
+		address_t _base, _top;
+		line_index_t *_index;
+		std::atomic<int> _state;
+	};
+
+	class LineIter: public PreIterator<LineIter, const LineNumber *> {
+	public:
+		LineIter(const unit_index_t& units, int i, int end, address_t lo, address_t hi);
+		inline bool ended() const { return _i >= _end; }
+		inline const LineNumber *item() const { return (*_lines)[_j].line; }
+		inline address_t address() const { return (*_lines)[_j].lo; }
+		inline address_t topAddress() const { return (*_lines)[_j].hi; }
+		void next();
+		inline bool equals(const LineIter& i) const
+			{ return _i == i._i && (ended() || _j == i._j); }
+	private:
+		void start();
+		void seek();
+		const unit_index_t& _units;
+		int _i, _end;
+		const line_index_t *_lines;
+		int _j;
+		address_t _lo, _hi;
 	};
 
-	DebugLine(gel::File *file);
+	DebugLine(gel::File *file, bool compact = false);
 
 	inline const HashMap<sys::Path, File *>& files() const { return _files; }
 	inline const FragTable<CompilationUnit *>& units() const { return _cus; }
 	inline gel::File& program() const { return prog; }
+	inline bool isCompact() const { return _compact; }
 	const LineNumber *lineAt(address_t addr) const;
-	
+	bool lineAt(address_t addr, LineNumber& line) const;
+	Range<LineIter> linesIn(address_t lo, address_t hi) const;
+
 protected:
 	virtual ~DebugLine();
 	void add(CompilationUnit *cu);
 	void add(File *file);
+	File *define(CompilationUnit *cu, sys::Path path, t::uint64 date = 0, size_t size = 0);
+	void defer(CompilationUnit *cu, bool bound = false);
+	virtual void bound(CompilationUnit *cu);
+	virtual void bound(const Vector<CompilationUnit *>& cus);
+	virtual void load(CompilationUnit *cu, bool ranges);
 	gel::File& prog;
 private:
+	void require(const CompilationUnit *cu, int state) const;
+	void boundAll() const;
+	const unit_index_t& index() const;
 	FragTable<CompilationUnit *> _cus;
 	HashMap<sys::Path, File *> _files;
+	bool _compact;
+	mutable std::atomic<unit_index_t *> _index;
+	mutable std::mutex _index_mutex;
+	mutable std::mutex _load_mutex;
+	mutable std::mutex _ranges_mutex;
 };
 
 }	// gel
@@ -20,8 +20,11 @@
 #ifndef GELPP_FILE_H_
 #define GELPP_FILE_H_
 
+#include <atomic>
+#include <mutex>
 #include <elm/data/Array.h>
 #include <elm/data/HashMap.h>
+#include <elm/data/Vector.h>
 #include <elm/sys/Path.h>
 #include <gel++/base.h>
 
@@ -62,6 +65,7 @@ public:
 	virtual bool isWritable() = 0;
 	virtual bool hasContent() = 0;
 	virtual Buffer buffer() = 0;
+	virtual Buffer fileBuffer();
 };
 
 class Section: public Segment {
@@ -101,7 +105,18 @@ public:
 
 class SymbolTable: public HashMap<cstring, Symbol *> {
 public:
+	SymbolTable();
 	virtual ~SymbolTable();
+	Symbol *at(address_t a) const;
+	Symbol *nearest(address_t a) const;
+	void invalidate();
+protected:
+	virtual void collect(Vector<Symbol *>& syms) const;
+private:
+	class Index;
+	const Index& index() const;
+	mutable std::atomic<Index *> _index;
+	mutable std::mutex _mutex;
 };
 
 class DebugLine;
@@ -135,7 +150,9 @@ public:
 
 	virtual int countSections();
 	virtual Section *section(int i);
+	virtual cstring sectionName(int i);
 	virtual Section *findSection(cstring name);
+	Vector<Section *> findSections(cstring prefix);
 	
 	virtual const SymbolTable& symbols() = 0;
 	virtual DebugLine *debugLines();
@@ -147,7 +164,11 @@ public:
 protected:
 	Manager& man;
 private:
+	class SectionIndex;
+	const SectionIndex& sectionIndex();
 	sys::Path _path;
+	std::atomic<SectionIndex *> _sindex;
+	std::mutex _smutex;
 };
 
 io::Output& operator<<(io::Output& out, File::type_t t);
@@ -19,7 +19,10 @@
 #ifndef GELPP_IMAGE_H_
 #define GELPP_IMAGE_H_
 
+#include <atomic>
+#include <mutex>
 #include <elm/data/BiDiList.h>
+#include <elm/data/Vector.h>
 #include <elm/util/ErrorHandler.h>
 #include <gel++/base.h>
 #include <gel++/File.h>
@@ -39,20 +42,35 @@ public:
 		CONTENT		= 0x08,
 		STACK		= 0x10,
 		TO_FREE		= 0x20;
+	static const int page_bits = 12;
+	static const size_t page_size = size_t(1) << page_bits;
 
 	ImageSegment(Buffer buf, address_t addr, flags_t flags, cstring name = "");
 	ImageSegment(File *file, Buffer buf, address_t addr, flags_t flags, cstring name = "");
+	ImageSegment(File *file, Buffer buf, address_t addr, size_t size, flags_t flags, cstring name = "");
 	ImageSegment(File *file, Segment *segment, address_t addr, cstring name = "");
+	ImageSegment(Decoder *decoder, address_t addr, size_t size, flags_t flags, cstring name = "");
 	~ImageSegment(void);
 	void clean(void);
 	inline File *file() const { return _file; }
 	inline Segment *segment() const { return _seg; }
 	inline address_t base() const { return _base; }
-	inline const Buffer& buffer() const { return _buf; }
-	inline range_t range() const { return range_t(_base, _buf.size()); }
+	const Buffer& buffer() const;
+	Buffer writableBuffer();
+	inline range_t range() const { return range_t(_base, _size); }
 	inline flags_t flags() const { return _flags; }
 	inline bool isReadable() const { return _flags & READABLE; }
 	inline bool isStack() const { return _flags & STACK; }
+	inline bool isShared() const { return _shared; }
+	inline Decoder *decoder() const { return _buf.decoder(); }
+	void read(offset_t offset, void *buf, size_t size) const;
+	void write(offset_t offset, const void *buf, size_t size);
+	bool isDirty(offset_t offset) const;
+	bool isZero(offset_t offset) const;
+	Vector<address_t> dirtyPages() const;
+	void clearDirty();
+	ImageSegment *fork();
+	void diff(const ImageSegment& segment, Vector<range_t>& ranges) const;
 
 	// Segment implementation
 	cstring name() override;
@@ -66,12 +84,51 @@ public:
 	Buffer buffer() override;
 
 private:
+	static const int leaf_bits = 9;
+	static const size_t leaf_size = size_t(1) << leaf_bits;
+	typedef struct page_t {
+		std::atomic<int> refs;
+		t::uint8 data[page_size];
+	} page_t;
+	typedef struct leaf_t {
+		std::atomic<int> refs;
+		page_t *pages[leaf_size];
+		t::uint64 dirty[leaf_size / 64];
+	} leaf_t;
+	typedef struct content_t {
+		std::atomic<int> refs;
+		t::uint8 *bytes;
+	} content_t;
+
+	ImageSegment(const ImageSegment& s);
+	void init(void);
+	void share(Buffer src);
+	void flatten();
+	void dropView();
+	leaf_t *leaf(size_t i);
+	const t::uint8 *page(size_t i) const;
+	t::uint8 *privatePage(size_t i);
+	void setDirty(offset_t offset, size_t size);
+	static void release(page_t *p);
+	static void release(leaf_t *l);
+	void releaseContent();
+	inline size_t pageCount() const { return (_size + page_size - 1) >> page_bits; }
+	inline size_t leafCount() const { return (pageCount() + leaf_size - 1) >> leaf_bits; }
+
 	cstring _name;
 	File *_file;
 	Segment *_seg;
 	address_t _base;
 	Buffer _buf;
+	size_t _size;
 	flags_t _flags;
+	bool _shared;
+	leaf_t **_dir;
+	size_t _pcnt;
+	content_t *_content;
+	mutable Buffer _view;
+	mutable std::atomic<bool> _has_view;
+	mutable std::mutex _view_mutex;
 };
 
 class Image {
@@ -96,13 +153,74 @@ public:
 	void add(File *file, address_t base = 0);
 	void add(ImageSegment *segment);
 	ImageSegment *at(address_t address);
+	Vector<address_t> dirtyPages() const;
+	Image *snapshot();
+	Vector<range_t> diff(const Image& image) const;
+
+	inline void read(address_t address, void *buf, size_t size) { transfer(address, buf, size, false); }
+	inline void write(address_t address, const void *buf, size_t size)
+		{ transfer(address, const_cast<void *>(buf), size, true); }
+	template <class T> inline void readN(address_t address, T *buf, size_t n)
+		{ transfer(address, buf, n * sizeof(T), false)->decoder()->decode(buf, n); }
+	template <class T> void writeN(address_t address, const T *buf, size_t n);
+
+	template <class T> inline const T *code(address_t address, size_t& count)
+		{ return static_cast<const T *>(codeAt(address, sizeof(T), count)); }
+	template <class T> inline T fetch(address_t address)
+		{ size_t c; return *code<T>(address, c); }
+	template <class T> inline void fetch(address_t address, T *words, size_t n) {
+		size_t c; const T *p = code<T>(address, c);
+		if(c < n) fetchError(address, n * sizeof(T));
+		for(size_t i = 0; i < n; i++) words[i] = p[i];
+	}
 
 private:
+	typedef struct shadow_t {
+		ImageSegment *seg;
+		size_t count;
+		t::uint8 *mem;
+		t::uint8 *words;
+	} shadow_t;
+	typedef Vector<shadow_t> shadows_t;
+	static const int shadow_widths = 4;
+
+	int lookup(address_t address) const;
+	ImageSegment *transfer(address_t address, void *buf, size_t size, bool write);
+	const void *codeAt(address_t address, int size, size_t& count);
+	shadows_t *shadows(int w);
+	void updateShadows(ImageSegment *seg, offset_t offset, size_t size);
+	static void fetchError(address_t address, size_t size);
 	File *_prog;
 	BiDiList<link_t> _links;
 	BiDiList<ImageSegment *> segs;
+	Vector<ImageSegment *> _sorted;
+	Vector<address_t> _tops;
+	t::uint64 _id;
+	bool _owns_files;
+	std::atomic<shadows_t *> _shadows[shadow_widths];
+	std::mutex _shadow_mutex;
 };
 
+template <class T> void Image::writeN(address_t address, const T *buf, size_t n) {
+	ImageSegment *s = at(address);
+	if(s == nullptr || s->decoder()->mode() == Decoder::NATIVE) {
+		transfer(address, const_cast<T *>(buf), n * sizeof(T), true);
+		return;
+	}
+	const size_t chunk = 256;
+	T tmp[chunk];
+	while(n != 0) {
+		size_t k = n < chunk ? n : chunk;
+		for(size_t i = 0; i < k; i++)
+			tmp[i] = buf[i];
+		s->decoder()->encode(tmp, k);
+		transfer(address, tmp, k * sizeof(T), true);
+		address += k * sizeof(T);
+		buf += k;
+		n -= k;
+	}
+}
+
 class Parameter {
 public:
 	static const cstring gen_abi, unix_abi;
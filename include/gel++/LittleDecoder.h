@@ -26,6 +26,7 @@ namespace gel {
 class LittleDecoder: public Decoder {
 public:
 	static LittleDecoder single;
+	LittleDecoder();
 
 	void fix(t::uint16& w) override;
 	void fix(t::int16& w) override;
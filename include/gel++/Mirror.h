@@ -0,0 +1,48 @@
+/*
+ * GEL++ Mirror class interface
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef GELPP_MIRROR_H_
+#define GELPP_MIRROR_H_
+
+#include <gel++/Image.h>
+
+namespace gel {
+
+class Mirror {
+public:
+	static const t::uint64 space = t::uint64(1) << 32;
+	typedef void (*fun_t)(void *data);
+
+	static bool isSupported();
+	Mirror(Image& image);
+	~Mirror();
+
+	inline t::uint8 *base() const { return _base; }
+	inline t::uint8 *host(address_t address) const { return _base + address; }
+	inline address_t target(const void *p) const { return static_cast<const t::uint8 *>(p) - _base; }
+	inline bool contains(const void *p) const
+		{ return _base <= static_cast<const t::uint8 *>(p) && static_cast<const t::uint8 *>(p) < _base + space; }
+	bool guard(fun_t fun, void *data, address_t& fault);
+
+private:
+	t::uint8 *_base;
+};
+
+} // gel
+
+#endif /* GELPP_MIRROR_H_ */
@@ -0,0 +1,113 @@
+/*
+ * GEL++ Source class interface
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef GELPP_SOURCE_H_
+#define GELPP_SOURCE_H_
+
+#include <mutex>
+#include <elm/data/Vector.h>
+#include <elm/io/RandomAccessStream.h>
+#include <elm/sys/Path.h>
+#include <gel++/base.h>
+
+namespace gel {
+
+using namespace elm;
+
+class Source {
+public:
+	Source(sys::Path path);
+	virtual ~Source();
+	inline sys::Path path() const { return _path; }
+
+	virtual size_t size() = 0;
+	virtual void read(offset_t pos, void *buf, size_t size) = 0;
+	virtual const t::uint8 *map(offset_t pos, size_t size);
+	virtual t::uint8 *mapPrivate(offset_t pos, size_t size);
+	virtual void prefetch(offset_t pos, size_t size);
+
+private:
+	sys::Path _path;
+};
+
+class StreamSource: public Source {
+public:
+	StreamSource(sys::Path path, io::RandomAccessStream *stream);
+	~StreamSource();
+	size_t size() override;
+	void read(offset_t pos, void *buf, size_t size) override;
+private:
+	io::RandomAccessStream *_stream;
+	std::mutex _mutex;
+};
+
+class CachedSource: public Source {
+public:
+	CachedSource(Source *source);
+	~CachedSource();
+	size_t size() override;
+	void read(offset_t pos, void *buf, size_t size) override;
+	const t::uint8 *map(offset_t pos, size_t size) override;
+	t::uint8 *mapPrivate(offset_t pos, size_t size) override;
+	void prefetch(offset_t pos, size_t size) override;
+private:
+	typedef struct {
+		offset_t pos;
+		size_t size;
+		t::uint8 *data;
+	} block_t;
+	const t::uint8 *lookup(offset_t pos, size_t size);
+	Source *_source;
+	Vector<block_t> _blocks;
+	std::mutex _mutex;
+};
+
+class FileSource: public Source {
+public:
+	static bool isSupported();
+	FileSource(sys::Path path);
+	~FileSource();
+	size_t size() override;
+	void read(offset_t pos, void *buf, size_t size) override;
+private:
+	int _fd;
+	size_t _size;
+};
+
+class MemorySource: public Source {
+public:
+	MemorySource(sys::Path name, const void *data, size_t size);
+	size_t size() override;
+	void read(offset_t pos, void *buf, size_t size) override;
+	const t::uint8 *map(offset_t pos, size_t size) override;
+protected:
+	const t::uint8 *_base;
+	size_t _size;
+};
+
+class MappedSource: public MemorySource {
+public:
+	static bool isSupported();
+	MappedSource(sys::Path path);
+	~MappedSource();
+	t::uint8 *mapPrivate(offset_t pos, size_t size) override;
+};
+
+} // gel
+
+#endif /* GELPP_SOURCE_H_ */
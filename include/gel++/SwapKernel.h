@@ -0,0 +1,53 @@
+/*
+ * GEL++ SwapKernel class interface
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef GELPP_SWAP_KERNEL_H_
+#define GELPP_SWAP_KERNEL_H_
+
+#include <initializer_list>
+#include <gel++/base.h>
+
+namespace gel {
+
+class SwapKernel {
+public:
+	typedef struct {
+		t::uint16 offset;
+		t::uint16 size;
+	} field_t;
+
+	static const int max_period = 256;
+
+	SwapKernel(t::uint32 size, std::initializer_list<field_t> fields);
+	inline t::uint32 size() const { return _size; }
+	inline bool isVector() const { return _period != 0; }
+	void apply(t::uint8 *buf, size_t n) const;
+	static const char *implementation();
+
+private:
+	void applyScalar(t::uint8 *buf, size_t n) const;
+	t::uint32 _size;
+	t::uint32 _period;
+	field_t _fields[16];
+	int _fcnt;
+	t::uint8 _perm[max_period];
+};
+
+}	// gel
+
+#endif	// GELPP_SWAP_KERNEL_H_
@@ -34,6 +34,7 @@ typedef t::uint64 size_t;
 typedef t::uint64 offset_t;
 
 typedef struct range_t {
+	inline range_t(): _addr(0), _size(0) { }
 	inline range_t(address_t a): _addr(a), _size(1) { }
 	inline range_t(address_t a, size_t s): _addr(a), _size(s) { }
 
@@ -64,9 +65,61 @@ io::IntFormat format(address_type_t t, address_t a);
 inline io::Output& operator<<(io::Output& out, const range_t& r)
 	{ out << format(address_64, r.base()) << ':' << format(address_64, r.size()); return out; }
 
+inline t::uint16 swapBytes(t::uint16 x)
+	{ return t::uint16((x << 8) | (x >> 8)); }
+inline t::uint32 swapBytes(t::uint32 x)
+	{ return (x << 24) | ((x << 8) & 0x00ff0000) | ((x >> 8) & 0x0000ff00) | (x >> 24); }
+inline t::uint64 swapBytes(t::uint64 x)
+	{ return (t::uint64(swapBytes(t::uint32(x))) << 32) | swapBytes(t::uint32(x >> 32)); }
+inline t::int16 swapBytes(t::int16 x) { return t::int16(swapBytes(t::uint16(x))); }
+inline t::int32 swapBytes(t::int32 x) { return t::int32(swapBytes(t::uint32(x))); }
+inline t::int64 swapBytes(t::int64 x) { return t::int64(swapBytes(t::uint64(x))); }
+
 class Decoder {
 public:
+	typedef enum {
+		CUSTOM,
+		NATIVE,
+		SWAP
+	} mode_t;
+
+	inline Decoder(mode_t mode = CUSTOM): _mode(mode) { }
 	virtual ~Decoder(void);
+	inline mode_t mode(void) const { return _mode; }
+
+	template <class T> inline void decode(T& w) {
+		switch(_mode) {
+		case NATIVE:	break;
+		case SWAP:		w = swapBytes(w); break;
+		default:		fix(w); break;
+		}
+	}
+	template <class T> inline void encode(T& w) {
+		switch(_mode) {
+		case NATIVE:	break;
+		case SWAP:		w = swapBytes(w); break;
+		default:		unfix(w); break;
+		}
+	}
+	template <class T> inline void decode(T *w, size_t n) {
+		switch(_mode) {
+		case NATIVE:	break;
+		case SWAP:		for(size_t i = 0; i < n; i++) w[i] = swapBytes(w[i]); break;
+		default:		for(size_t i = 0; i < n; i++) fix(w[i]); break;
+		}
+	}
+	template <class T> inline void encode(T *w, size_t n) {
+		switch(_mode) {
+		case NATIVE:	break;
+		case SWAP:		for(size_t i = 0; i < n; i++) w[i] = swapBytes(w[i]); break;
+		default:		for(size_t i = 0; i < n; i++) unfix(w[i]); break;
+		}
+	}
+	inline void decode(t::uint8 *w, size_t n) { }
+	inline void decode(t::int8 *w, size_t n) { }
+	inline void encode(t::uint8 *w, size_t n) { }
+	inline void encode(t::int8 *w, size_t n) { }
+
 	virtual void fix(t::uint16& w) = 0;
 	virtual void fix(t::int16& w) = 0;
 	virtual void fix(t::uint32& w) = 0;
@@ -80,6 +133,12 @@ public:
 	virtual void unfix(t::int32& w) = 0;
 	virtual void unfix(t::uint64& w) = 0;
 	virtual void unfix(t::int64& w) = 0;
+
+protected:
+	inline void setMode(mode_t mode) { _mode = mode; }
+
+private:
+	mode_t _mode;
 };
 
 class Buffer {
@@ -105,17 +164,17 @@ public:
 	inline void get(offset_t off, t::int8& r) const
 		{ ASSERT(off + sizeof(t::int8) <= sz); r = *(t::int8 *)(b + off); }
 	inline void get(offset_t off, t::uint16& r) const
-		{ ASSERT(off + sizeof(t::uint16) <= sz); d->fix(r = *(t::uint16 *)(b + off)); }
+		{ ASSERT(off + sizeof(t::uint16) <= sz); d->decode(r = *(t::uint16 *)(b + off)); }
 	inline void get(offset_t off, t::int16& r) const
-		{ ASSERT(off + sizeof(t::int16) <= sz); d->fix(r = *(t::int16 *)(b + off)); }
+		{ ASSERT(off + sizeof(t::int16) <= sz); d->decode(r = *(t::int16 *)(b + off)); }
 	inline void get(offset_t off, t::uint32& r) const
-		{ ASSERT(off + sizeof(t::uint32) <= sz); d->fix(r = *(t::uint32 *)(b + off)); }
+		{ ASSERT(off + sizeof(t::uint32) <= sz); d->decode(r = *(t::uint32 *)(b + off)); }
 	inline void get(offset_t off, t::int32& r) const
-		{ ASSERT(off + sizeof(t::int32) <= sz); d->fix(r = *(t::int32 *)(b + off)); }
+		{ ASSERT(off + sizeof(t::int32) <= sz); d->decode(r = *(t::int32 *)(b + off)); }
 	inline void get(offset_t off, t::uint64& r) const
-		{ ASSERT(off + sizeof(t::uint64) <= sz); d->fix(r = *(t::uint64 *)(b + off)); }
+		{ ASSERT(off + sizeof(t::uint64) <= sz); d->decode(r = *(t::uint64 *)(b + off)); }
 	inline void get(offset_t off, t::int64& r) const
-		{ ASSERT(off + sizeof(t::int64) <= sz); d->fix(r = *(t::int64 *)(b + off)); }
+		{ ASSERT(off + sizeof(t::int64) <= sz); d->decode(r = *(t::int64 *)(b + off)); }
 	inline void get(offset_t off, cstring& s)
 		{ ASSERT(off < sz); s = cstring((const char *)(b + off)); }
 	inline void get(offset_t off, string& s)
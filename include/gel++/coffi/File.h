@@ -41,6 +41,7 @@ class File: public gel::File {
 	friend class Symbol;
 public:
 	File(Manager& manager, sys::Path path);
+	File(Manager& manager, sys::Path name, const void *data, size_t size);
 	~File();
 	static bool matches(t::uint8 magic[4]);
 
@@ -59,6 +60,7 @@ public:
 	gel::DebugLine * debugLines() override;
 
 private:
+	void init();
 	COFFI::coffi *_reader;
 	address_t _base;
 	Vector<Section *> _sections;
@@ -19,6 +19,7 @@
 #ifndef GELPP_DWARF_DEBUG_LINE_H
 #define GELPP_DWARF_DEBUG_LINE_H
 
+#include <exception>
 #include <elm/data/FragTable.h>
 #include <elm/data/HashMap.h>
 #include <gel++/elf/defs.h>
@@ -37,7 +38,13 @@ public:
 	class StateMachine {
 	public:
 		inline StateMachine() { include_directories.add("."); }
+		inline void reset() {
+			address = 0; op_index = 0; file = 1; line = 1; column = 0;
+			isa = 0; discriminator = 0; end_sequence = false; flags = default_flags;
+			in_sequence = false;
+		}
 		t::uint16 version;
+		bool is_64 = false;
 		address_t address = 0;
 		t::uint32
 			op_index = 0,
@@ -46,8 +53,10 @@ public:
 			column = 0,
 			isa = 0,
 			discriminator = 0;
-		bool end_sequence = false;
-		t::uint8 flags = 0;
+		bool end_sequence = false, in_sequence = false;
+		address_t sequence_base = 0;
+		bool record_lines = true, record_ranges = true;
+		t::uint8 flags = 0, default_flags = 0;
 		inline void set(t::uint8 m) { flags |= m; }
 		inline void clear(t::uint8 m) { flags &= ~m; }
 		inline bool bit(t::uint8 m) { return (flags & m) != 0; }
@@ -72,27 +81,73 @@ public:
 		bool epilogue_begin = false;	// DWARF-5 (TODO)
 	};
 
-	DebugLine(elf::File *efile);
-	DebugLine(gel::File *file, Buffer buf);
+	DebugLine(elf::File *efile, bool lazy = false, bool compact = false);
+	DebugLine(gel::File *file, Buffer buf, bool compact = false);
+
+protected:
+	void bound(CompilationUnit *cu) override;
+	void bound(const Vector<CompilationUnit *>& cus) override;
+	void load(CompilationUnit *cu, bool ranges) override;
 
 private:
-	void readCU(Cursor& c);
+	class Unit: public CompilationUnit {
+	public:
+		StateMachine sm;
+		size_t offset, program, end;
+		int header_files;
+		bool has_ranges;
+		Vector<File *> program_files;
+		inline File *file(int i) const
+			{ return i < header_files ? files()[i] : program_files[i - header_files]; }
+	};
+
+	class UnitList: public Vector<Unit *> {
+	public:
+		inline ~UnitList() { for(auto u: *this) delete u; }
+	};
+
+	class Rows {
+	public:
+		typedef struct {
+			address_t addr;
+			t::uint32 file, line, col;
+			t::uint8 flags, isa, disc, opi;
+		} row_t;
+		typedef struct {
+			sys::Path path;
+			t::uint64 date, size;
+		} file_t;
+		Vector<row_t> rows;
+		Vector<Pair<address_t, address_t> > ranges;
+		Vector<file_t> files;
+		std::exception_ptr error;
+	};
+
+	void readCU(Cursor& c, UnitList& units);
+	void decode(const Vector<Unit *>& units, bool lines, bool ranges);
+	void check(Unit *u, const Rows& rows);
+	void merge(Unit *u, const Rows& rows, bool lines, bool ranges);
+	void readARanges(elf::File *efile, const Vector<Unit *>& units);
+	bool readStmtList(Cursor info, Cursor abbrev, offset_t offset, offset_t& stmt);
+	void skipForm(Cursor& c, t::uint64 form, int version, int addr_size, bool is_64);
+	t::uint64 readSized(Cursor& c, size_t size);
 	void readHeader(Cursor& c, StateMachine& sm, CompilationUnit *cu);
-	void runSM(Cursor& c, StateMachine& sm, CompilationUnit *cu, size_t end);
-	void advancePC(StateMachine& sm, CompilationUnit *cu, t::uint64 adv);
+	void runSM(Cursor& c, StateMachine& sm, Rows& rows, size_t end);
+	void advancePC(StateMachine& sm, t::uint64 adv);
 	void advanceLine(StateMachine& sm, t::int64 adv);
-	void recordLine(StateMachine& sm, CompilationUnit *cu);
+	void recordLine(StateMachine& sm, Rows& rows);
 	void readDir(Cursor &c, StateMachine &sm);
 	void readFile(Cursor& c, StateMachine& sm, CompilationUnit *cu);
-	size_t readHeaderLength(Cursor& c);
-	size_t readUnitLength(Cursor& c);
+	sys::Path readFileEntry(Cursor& c, StateMachine& sm, cstring name, t::uint64& date, t::uint64& size);
+	size_t readHeaderLength(Cursor& c, StateMachine& sm);
+	size_t readUnitLength(Cursor& c, bool& is_64);
 	t::int64 readLEB128S(Cursor& c);
 	t::uint64 readLEB128U(Cursor& c);
 	inline static void error_if(bool cond)
 		{ if(cond) throw gel::Exception("debug line error"); }
-	address_t readAddress(Cursor& c);
+	address_t readAddress(Cursor& c, bool is_64);
 
-	bool is_64;
+	Cursor line_cursor;
 	Cursor str_sect_cursor;
 	Cursor line_str_sect_cursor;
 };
@@ -19,12 +19,15 @@
 #ifndef GELPP_ELF_FILE_H_
 #define GELPP_ELF_FILE_H_
 
+#include <atomic>
+#include <mutex>
 #include <elm/data/HashMap.h>
 #include <elm/data/List.h>
 #include <elm/data/Vector.h>
 #include <elm/io/RandomAccessStream.h>
 #include "../Exception.h"
 #include "../File.h"
+#include "../Source.h"
 #include "defs.h"
 
 namespace gel { namespace elf {
@@ -36,6 +39,7 @@ public:
 	ProgramHeader(elf::File *file);
 	virtual ~ProgramHeader();
 	Buffer content();
+	Buffer fileContent();
 	inline bool contains(address_t a) const { return vaddr() <= a && a < vaddr() + memsz(); }
 	inline Decoder *decoder(void) const;
 
@@ -50,11 +54,13 @@ public:
 
 protected:
 	virtual t::uint8 *readBuf() = 0;
-	inline void readAt(t::uint32 pos, void *buf, t::uint32 size);
+	inline void readAt(offset_t pos, void *buf, size_t size);
+	t::uint8 *map(offset_t pos, size_t size);
 
 private:
 	elf::File *_file;
-	t::uint8 *_buf;
+	std::atomic<t::uint8 *> _buf;
+	bool _own;
 };
 
 
@@ -78,12 +84,14 @@ public:
 
 protected:
 	virtual t::uint8 *readBuf() = 0;
-	inline void readAt(t::uint32 pos, void *buf, t::uint32 size);
+	inline void readAt(offset_t pos, void *buf, size_t size);
 	inline elf::File *file() const { return _file; }
+	t::uint8 *map(offset_t pos, size_t size);
 
 private:
 	elf::File *_file;
-	t::uint8 *buf;
+	std::atomic<t::uint8 *> buf;
+	bool own;
 };
 
 class Symbol: public gel::Symbol {
@@ -96,6 +104,8 @@ public:
 	virtual int shndx() = 0;
 
 	cstring name() override;
+	type_t type() override;
+	bind_t bind() override;
 
 protected:
 	cstring _name;
@@ -104,10 +114,28 @@ protected:
 
 class SymbolTable: public gel::SymbolTable {
 public:
+	SymbolTable();
 	~SymbolTable();
-	void record(elm::t::uint8 *mem);
+
+	void reserve(int n);
+	Symbol *add(cstring name, t::uint64 value, t::uint64 size, t::uint8 info, t::uint8 other, t::uint32 shndx);
+	inline int length() const { return _cnt; }
+	Symbol& entry(int i) const;
+	Vector<Symbol *> all(cstring name) const;
+
+protected:
+	void collect(Vector<gel::Symbol *>& syms) const override;
+
 private:
-	List<elm::t::uint8 *> mems;
+	class View;
+	t::uint8 *_arena;
+	View *_views;
+	t::uint64 *_values, *_sizes;
+	t::uint32 *_shndx;
+	t::uint8 *_info, *_other;
+	int _cnt, _cap;
+	mutable std::atomic<int *> _byname;
+	mutable std::mutex _mutex;
 };
 
 class DynEntry {
@@ -125,17 +153,21 @@ class File: public gel::File, public Decoder {
 	friend class Segment;
 public:
 	File(Manager& manager, sys::Path path, io::RandomAccessStream *stream);
+	File(Manager& manager, sys::Path path, Source *source);
 	virtual ~File(void);
 	static bool matches(t::uint8 magic[4]);
+	inline Source *source() const { return src; }
+	bool isNative();
 
 	virtual int elfType() = 0;
 	virtual t::uint16 version() = 0;
 	virtual const t::uint8 *ident() = 0;
+	virtual void prefetchHeaders() = 0;
 
 	typedef Vector<Section *>::Iter SecIter;
 	Vector<Section *>& sections(void);
-	inline Section *sectionAt(int i) const { return sects[i]; }
-	inline int sectionCount(void) const { return sects.count(); }
+	Section *sectionAt(int i);
+	int sectionCount(void);
 
 	typedef Vector<ProgramHeader *>::Iter ProgIter;
 	Vector<ProgramHeader *>& programHeaders(void);
@@ -147,6 +179,7 @@ public:
 
 	const gel::SymbolTable& symbols() override;
 	virtual void fillSymbolTable(SymbolTable& symtab, Section *sect) = 0;
+	Symbol *lookupDynamic(cstring name);
 
 	// gel::File overload
 	File *toELF() override;
@@ -157,9 +190,11 @@ public:
 	string machine() const override;
 	string os() const override;
 	gel::DebugLine *debugLines() override;
+	inline void setCompactLines(bool compact) { compact_lines = compact; }
+	inline void setLazyLines(bool lazy) { lazy_lines = lazy; }
 	int countSections() override;
-	gel::Section *findSection(cstring name) override;
 	Section *section(int i) override;
+	cstring sectionName(int i) override;
 
 	// Decoder override
 	void fix(t::uint16& i) override;
@@ -177,11 +212,22 @@ public:
 	void unfix(t::int64& w) override;
 
 protected:
+	static const size_t shstrtab_guess;
 	inline void setIdent(t::uint8 *i) { id = i; }
 	virtual void loadProgramHeaders(Vector<ProgramHeader *>& headers) = 0;
-	virtual void loadSections(Vector<Section *>& segments) = 0;
+	virtual int loadSectionHeaders() = 0;
+	virtual Section *makeSection(int i) = 0;
+	Buffer extendedIndexes(Section *symtab);
 	virtual int getStrTab() = 0;
 
+	typedef struct shdr_t {
+		t::uint32 name;
+		t::uint32 type;
+		t::uint32 link;
+	} shdr_t;
+	virtual void fetchSection(int i, shdr_t& sect) = 0;
+	int findSectionOfType(t::uint32 type, int from = 0);
+
 	typedef struct dyn_t {
 		int tag;
 		union {
@@ -191,8 +237,19 @@ protected:
 	} dyn_t;
 	virtual void fetchDyn(const t::uint8 *entry, dyn_t& dyn) = 0;
 
-	void read(void *buf, t::uint32 size);
-	void readAt(t::uint32 pos, void *buf, t::uint32 size);
+	typedef struct sym_t {
+		t::uint32 name;
+		t::uint64 value;
+		t::uint64 size;
+		t::uint8 info;
+		t::uint8 other;
+		t::uint16 shndx;
+	} sym_t;
+	virtual void fetchSym(const t::uint8 *entry, sym_t& sym) = 0;
+
+	void readAt(offset_t pos, void *buf, size_t size);
+	const t::uint8 *mapAt(offset_t pos, size_t size);
+	t::uint8 *mapPrivateAt(offset_t pos, size_t size);
 
 public:
 	// iterators
@@ -222,20 +279,32 @@ public:
 	Range<DynIter> dyns(Section *sect);
 
 private:
+	class DynLookup;
 	void initSections();
 	void initSegments();
+	DynLookup& dynLookup();
+	bool findDynamic(DynLookup& d, cstring name, sym_t& sym);
+	bool addressToOffset(address_t a, offset_t& off);
+	bool matchString(offset_t pos, size_t max, cstring name);
 
-	io::RandomAccessStream *s;
+	Source *src;
 	t::uint8 *id;
-	bool ph_loaded;
+	std::atomic<bool> ph_loaded;
 	Vector<ProgramHeader *> phs;
-	bool sects_loaded;
+	std::atomic<bool> sects_loaded;
+	int sect_cnt;
+	std::atomic<Section *> *sect_tab;
+	std::atomic<bool> sects_all;
 	Vector<Section *> sects;
 	Section *str_tab;
-	SymbolTable *syms;
+	std::atomic<SymbolTable *> syms;
 	Vector<Segment *> segs;
-	bool segs_init;
-	DebugLine *debug;
+	std::atomic<bool> segs_init;
+	std::atomic<DebugLine *> debug;
+	bool compact_lines;
+	bool lazy_lines;
+	std::atomic<DynLookup *> dlookup;
+	std::recursive_mutex lock;
 };
 
 class NoteIter {
@@ -261,9 +330,9 @@ private:
 };
 
 inline Decoder *ProgramHeader::decoder(void) const { return _file; }
-inline void ProgramHeader::readAt(t::uint32 pos, void *buf, t::uint32 size)
+inline void ProgramHeader::readAt(offset_t pos, void *buf, size_t size)
 	{ _file->readAt(pos, buf, size); }
-inline void Section::readAt(t::uint32 pos, void *buf, t::uint32 size)
+inline void Section::readAt(offset_t pos, void *buf, size_t size)
 	{ _file->readAt(pos, buf, size); }
 
 } }	// gel::elf
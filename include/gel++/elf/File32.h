@@ -24,6 +24,7 @@
 #include <elm/io/RandomAccessStream.h>
 #include "../Exception.h"
 #include "File.h"
+#include "Reader.h"
 #include "defs.h"
 
 namespace gel { namespace elf {
@@ -54,8 +55,8 @@ private:
 
 class Section32: public elf::Section {
 public:
-	Section32(elf::File32 *file, Elf32_Shdr *entry);
-	inline const Elf32_Shdr& info(void) { return *_info; }
+	Section32(elf::File32 *file, const Elf32_Shdr& entry);
+	inline const Elf32_Shdr& info(void) { return _info; }
 
 	// Section override
 	cstring name() override;
@@ -84,7 +85,7 @@ protected:
 	t::uint8 *readBuf() override;
 
 private:
-	Elf32_Shdr *_info;
+	Elf32_Shdr _info;
 };
 
 class File32: public elf::File {
@@ -92,6 +93,7 @@ class File32: public elf::File {
 	friend class Section32;
 public:
 	File32(Manager& manager, sys::Path path, io::RandomAccessStream *stream);
+	File32(Manager& manager, sys::Path path, Source *source);
 	~File32(void);
 
 	const Elf32_Ehdr& info(void) const { return *h; }
@@ -102,6 +104,7 @@ public:
 	int elfOS() const override;
 	t::uint16 version() override;
 	const t::uint8 *ident() override;
+	void prefetchHeaders() override;
 	void fillSymbolTable(SymbolTable& symtab, Section *sect) override;
 
 	// gel::File overload
@@ -111,13 +114,19 @@ public:
 
 protected:
 	void loadProgramHeaders(Vector<ProgramHeader *>& headers) override;
-	void loadSections(Vector<Section *>& sections) override;
+	int loadSectionHeaders() override;
+	Section *makeSection(int i) override;
+	void fetchSection(int i, shdr_t& sect) override;
 	int getStrTab() override;
 	void fetchDyn(const t::uint8 *entry, dyn_t& dyn) override;
+	void fetchSym(const t::uint8 *entry, sym_t& sym) override;
 
 private:
+	Codec<ELFCLASS32> codec;
 	Elf32_Ehdr *h;
+	t::uint32 shnum, shstrndx, phnum;
 	t::uint8 *sec_buf;
+	bool sec_own;
 	t::uint8 *ph_buf;
 };
 
@@ -24,6 +24,7 @@
 #include <elm/io/RandomAccessStream.h>
 #include "../Exception.h"
 #include "File.h"
+#include "Reader.h"
 #include "defs64.h"
 
 namespace gel { namespace elf {
@@ -54,8 +55,8 @@ private:
 
 class Section64: public elf::Section {
 public:
-	Section64(elf::File64 *file, Elf64_Shdr *entry);
-	inline const Elf64_Shdr& info(void) { return *_info; }
+	Section64(elf::File64 *file, const Elf64_Shdr& entry);
+	inline const Elf64_Shdr& info(void) { return _info; }
 
 	// Section override
 	cstring name() override;
@@ -83,7 +84,7 @@ protected:
 	t::uint8 *readBuf() override;
 
 private:
-	Elf64_Shdr *_info;
+	Elf64_Shdr _info;
 };
 
 class File64: public elf::File {
@@ -91,6 +92,7 @@ class File64: public elf::File {
 	friend class Section64;
 public:
 	File64(Manager& manager, sys::Path path, io::RandomAccessStream *stream);
+	File64(Manager& manager, sys::Path path, Source *source);
 	~File64(void);
 
 	const Elf64_Ehdr& info(void) const { return *h; }
@@ -101,6 +103,7 @@ public:
 	int elfOS() const override;
 	t::uint16 version() override;
 	const t::uint8 *ident() override;
+	void prefetchHeaders() override;
 	void fillSymbolTable(SymbolTable& symtab, Section *sect) override;
 
 	// gel::File overload
@@ -110,13 +113,19 @@ public:
 
 protected:
 	void loadProgramHeaders(Vector<ProgramHeader *>& headers) override;
-	void loadSections(Vector<Section *>& sections) override;
+	int loadSectionHeaders() override;
+	Section *makeSection(int i) override;
+	void fetchSection(int i, shdr_t& sect) override;
 	int getStrTab() override;
 	void fetchDyn(const t::uint8 *entry, dyn_t& dyn) override;
+	void fetchSym(const t::uint8 *entry, sym_t& sym) override;
 
 private:
+	Codec<ELFCLASS64> codec;
 	Elf64_Ehdr *h;
+	t::uint32 shnum, shstrndx, phnum;
 	t::uint8 *sec_buf;
+	bool sec_own;
 	t::uint8 *ph_buf;
 };
 
@@ -0,0 +1,264 @@
+/*
+ * gel::elf::Reader class
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef GELPP_ELF_READER_H_
+#define GELPP_ELF_READER_H_
+
+#include <cstddef>
+#include "../base.h"
+#include "../SwapKernel.h"
+#include "defs.h"
+#include "defs64.h"
+
+namespace gel { namespace elf {
+
+// byte order of the host (taken from the compiler to be the same in all units)
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__)
+#	if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	const int host_data = ELFDATA2MSB;
+#	else
+	const int host_data = ELFDATA2LSB;
+#	endif
+#elif defined(BIGENDIAN)
+	const int host_data = ELFDATA2MSB;
+#else
+	const int host_data = ELFDATA2LSB;
+#endif
+
+/**
+ * Traits giving the ELF structures for a class (ELFCLASS32 or ELFCLASS64).
+ * @ingroup elf
+ */
+template <int C> class Class;
+
+template <> class Class<ELFCLASS32> {
+public:
+	typedef Elf32_Ehdr Ehdr;
+	typedef Elf32_Shdr Shdr;
+	typedef Elf32_Phdr Phdr;
+	typedef Elf32_Sym Sym;
+	typedef Elf32_Dyn Dyn;
+	typedef Elf32_Rel Rel;
+	typedef Elf32_Rela Rela;
+};
+
+template <> class Class<ELFCLASS64> {
+public:
+	typedef Elf64_Ehdr Ehdr;
+	typedef Elf64_Shdr Shdr;
+	typedef Elf64_Phdr Phdr;
+	typedef Elf64_Sym Sym;
+	typedef Elf64_Dyn Dyn;
+	typedef Elf64_Rel Rel;
+	typedef Elf64_Rela Rela;
+};
+
+/**
+ * Byte order conversion for an ELF data encoding (ELFDATA2LSB or ELFDATA2MSB).
+ * As the encoding is known at compile time, the conversions are inlined and
+ * reduce to nothing when the encoding is the one of the host.
+ * @ingroup elf
+ */
+template <int E> class Endian {
+public:
+	static const bool native = E == host_data;
+	template <class T> static inline T get(T x) { return native ? x : swapBytes(x); }
+	template <class T> static inline void fix(T& x) { if(!native) x = swapBytes(x); }
+};
+
+/**
+ * Bulk byte-swapping kernels for the ELF tables. Each specialization
+ * provides the kernel swapping a contiguous table of records.
+ * @ingroup elf
+ */
+template <class T> class Swap;
+
+#define GEL_FIELD(T, f)	{ offsetof(T, f), sizeof(((T *)0)->f) }
+#define GEL_SWAP(T, ...) \
+	template <> class Swap<T> { \
+	public: \
+		static const SwapKernel& kernel() { static const SwapKernel k(sizeof(T), { __VA_ARGS__ }); return k; } \
+	};
+
+GEL_SWAP(Elf32_Shdr,
+	GEL_FIELD(Elf32_Shdr, sh_name), GEL_FIELD(Elf32_Shdr, sh_type), GEL_FIELD(Elf32_Shdr, sh_flags),
+	GEL_FIELD(Elf32_Shdr, sh_addr), GEL_FIELD(Elf32_Shdr, sh_offset), GEL_FIELD(Elf32_Shdr, sh_size),
+	GEL_FIELD(Elf32_Shdr, sh_link), GEL_FIELD(Elf32_Shdr, sh_info), GEL_FIELD(Elf32_Shdr, sh_addralign),
+	GEL_FIELD(Elf32_Shdr, sh_entsize))
+GEL_SWAP(Elf32_Phdr,
+	GEL_FIELD(Elf32_Phdr, p_type), GEL_FIELD(Elf32_Phdr, p_offset), GEL_FIELD(Elf32_Phdr, p_vaddr),
+	GEL_FIELD(Elf32_Phdr, p_paddr), GEL_FIELD(Elf32_Phdr, p_filesz), GEL_FIELD(Elf32_Phdr, p_memsz),
+	GEL_FIELD(Elf32_Phdr, p_flags), GEL_FIELD(Elf32_Phdr, p_align))
+GEL_SWAP(Elf32_Sym,
+	GEL_FIELD(Elf32_Sym, st_name), GEL_FIELD(Elf32_Sym, st_value), GEL_FIELD(Elf32_Sym, st_size),
+	GEL_FIELD(Elf32_Sym, st_shndx))
+GEL_SWAP(Elf32_Dyn,
+	GEL_FIELD(Elf32_Dyn, d_tag), GEL_FIELD(Elf32_Dyn, d_un.d_val))
+GEL_SWAP(Elf32_Rel,
+	GEL_FIELD(Elf32_Rel, r_offset), GEL_FIELD(Elf32_Rel, r_info))
+GEL_SWAP(Elf32_Rela,
+	GEL_FIELD(Elf32_Rela, r_offset), GEL_FIELD(Elf32_Rela, r_info), GEL_FIELD(Elf32_Rela, r_addend))
+GEL_SWAP(Elf64_Shdr,
+	GEL_FIELD(Elf64_Shdr, sh_name), GEL_FIELD(Elf64_Shdr, sh_type), GEL_FIELD(Elf64_Shdr, sh_flags),
+	GEL_FIELD(Elf64_Shdr, sh_addr), GEL_FIELD(Elf64_Shdr, sh_offset), GEL_FIELD(Elf64_Shdr, sh_size),
+	GEL_FIELD(Elf64_Shdr, sh_link), GEL_FIELD(Elf64_Shdr, sh_info), GEL_FIELD(Elf64_Shdr, sh_addralign),
+	GEL_FIELD(Elf64_Shdr, sh_entsize))
+GEL_SWAP(Elf64_Phdr,
+	GEL_FIELD(Elf64_Phdr, p_type), GEL_FIELD(Elf64_Phdr, p_flags), GEL_FIELD(Elf64_Phdr, p_offset),
+	GEL_FIELD(Elf64_Phdr, p_vaddr), GEL_FIELD(Elf64_Phdr, p_paddr), GEL_FIELD(Elf64_Phdr, p_filesz),
+	GEL_FIELD(Elf64_Phdr, p_memsz), GEL_FIELD(Elf64_Phdr, p_align))
+GEL_SWAP(Elf64_Sym,
+	GEL_FIELD(Elf64_Sym, st_name), GEL_FIELD(Elf64_Sym, st_shndx), GEL_FIELD(Elf64_Sym, st_value),
+	GEL_FIELD(Elf64_Sym, st_size))
+GEL_SWAP(Elf64_Dyn,
+	GEL_FIELD(Elf64_Dyn, d_tag), GEL_FIELD(Elf64_Dyn, d_un.d_val))
+GEL_SWAP(Elf64_Rel,
+	GEL_FIELD(Elf64_Rel, r_offset), GEL_FIELD(Elf64_Rel, r_info))
+GEL_SWAP(Elf64_Rela,
+	GEL_FIELD(Elf64_Rela, r_offset), GEL_FIELD(Elf64_Rela, r_info), GEL_FIELD(Elf64_Rela, r_addend))
+
+#undef GEL_SWAP
+#undef GEL_FIELD
+
+/**
+ * Decoder of ELF structures specialized at compile time for a class
+ * and a data encoding. fixTable() converts in place a whole table
+ * of entries and does nothing if the encoding is the host one: contiguous
+ * tables are swapped with the vector kernels of Swap.
+ * @ingroup elf
+ */
+template <int C, int E> class Reader {
+public:
+	typedef Endian<E> endian_t;
+	typedef typename Class<C>::Ehdr Ehdr;
+	typedef typename Class<C>::Shdr Shdr;
+	typedef typename Class<C>::Phdr Phdr;
+	typedef typename Class<C>::Sym Sym;
+	typedef typename Class<C>::Dyn Dyn;
+	typedef typename Class<C>::Rel Rel;
+	typedef typename Class<C>::Rela Rela;
+	static const bool native = endian_t::native;
+
+	static inline void fix(Ehdr& h) {
+		endian_t::fix(h.e_type);
+		endian_t::fix(h.e_machine);
+		endian_t::fix(h.e_version);
+		endian_t::fix(h.e_entry);
+		endian_t::fix(h.e_phoff);
+		endian_t::fix(h.e_shoff);
+		endian_t::fix(h.e_flags);
+		endian_t::fix(h.e_ehsize);
+		endian_t::fix(h.e_phentsize);
+		endian_t::fix(h.e_phnum);
+		endian_t::fix(h.e_shentsize);
+		endian_t::fix(h.e_shnum);
+		endian_t::fix(h.e_shstrndx);
+	}
+
+	static inline void fix(Shdr& s) {
+		endian_t::fix(s.sh_name);
+		endian_t::fix(s.sh_type);
+		endian_t::fix(s.sh_flags);
+		endian_t::fix(s.sh_addr);
+		endian_t::fix(s.sh_offset);
+		endian_t::fix(s.sh_size);
+		endian_t::fix(s.sh_link);
+		endian_t::fix(s.sh_info);
+		endian_t::fix(s.sh_addralign);
+		endian_t::fix(s.sh_entsize);
+	}
+
+	static inline void fix(Phdr& p) {
+		endian_t::fix(p.p_type);
+		endian_t::fix(p.p_flags);
+		endian_t::fix(p.p_offset);
+		endian_t::fix(p.p_vaddr);
+		endian_t::fix(p.p_paddr);
+		endian_t::fix(p.p_filesz);
+		endian_t::fix(p.p_memsz);
+		endian_t::fix(p.p_align);
+	}
+
+	static inline void fix(Sym& s) {
+		endian_t::fix(s.st_name);
+		endian_t::fix(s.st_value);
+		endian_t::fix(s.st_size);
+		endian_t::fix(s.st_shndx);
+	}
+
+	static inline void fix(Dyn& d) {
+		endian_t::fix(d.d_tag);
+		endian_t::fix(d.d_un.d_val);
+	}
+
+	static inline void fix(Rel& r) {
+		endian_t::fix(r.r_offset);
+		endian_t::fix(r.r_info);
+	}
+
+	static inline void fix(Rela& r) {
+		endian_t::fix(r.r_offset);
+		endian_t::fix(r.r_info);
+		endian_t::fix(r.r_addend);
+	}
+
+	template <class T> static void fixTable(t::uint8 *buf, size_t n, size_t entsize) {
+		if(native)
+			return;
+		if(entsize == sizeof(T)) {
+			Swap<T>::kernel().apply(buf, n);
+			return;
+		}
+		for(size_t i = 0; i < n; i++)
+			fix(*reinterpret_cast<T *>(buf + i * entsize));
+	}
+
+	static inline void readDyn(const t::uint8 *entry, t::int64& tag, t::uint64& val) {
+		const Dyn *d = reinterpret_cast<const Dyn *>(entry);
+		tag = endian_t::get(d->d_tag);
+		val = endian_t::get(d->d_un.d_val);
+	}
+};
+
+/**
+ * Select, once per table, the Reader matching the data encoding of a file
+ * whose class is known at compile time.
+ * @ingroup elf
+ */
+template <int C> class Codec {
+public:
+	typedef Reader<C, ELFDATA2LSB> lsb_t;
+	typedef Reader<C, ELFDATA2MSB> msb_t;
+
+	inline Codec(int data = host_data): msb(data == ELFDATA2MSB) { }
+	inline bool isNative() const { return msb == (host_data == ELFDATA2MSB); }
+
+	template <class T> inline void fix(T& x) const
+		{ if(msb) msb_t::fix(x); else lsb_t::fix(x); }
+	template <class T> inline void fixTable(t::uint8 *buf, size_t n, size_t entsize) const
+		{ if(msb) msb_t::template fixTable<T>(buf, n, entsize); else lsb_t::template fixTable<T>(buf, n, entsize); }
+	inline void readDyn(const t::uint8 *entry, t::int64& tag, t::uint64& val) const
+		{ if(msb) msb_t::readDyn(entry, tag, val); else lsb_t::readDyn(entry, tag, val); }
+
+private:
+	bool msb;
+};
+
+} }	// gel::elf
+
+#endif /* GELPP_ELF_READER_H_ */
@@ -72,12 +72,14 @@ namespace gel { namespace elf {
 
 // Special Section Indices
 #define SHN_UNDEF	0
+#define SHN_LORESERVE	0xFF00
 #define	SHN_LOPROC	0xFF00
 #define SHN_HIPROC	0xFF1F
 #define SHN_LOOS	0xFF20
 #define SHN_HIOS	0xFF3F
 #define SHN_ABS		0xFFF1
 #define SHN_COMMON	0xFFF2
+#define SHN_XINDEX	0xFFFF
 
 // Section Types, sh_type
 #define SHT_NULL		0
@@ -92,7 +94,9 @@ namespace gel { namespace elf {
 #define SHT_REL			9
 #define SHT_SHLIB		10
 #define SHT_DYNSYM		11
+#define SHT_SYMTAB_SHNDX	18
 #define SHT_LOOS		0x60000000
+#define SHT_GNU_HASH	0x6FFFFFF6
 #define SHT_HIOS		0x6FFFFFFF
 #define LOPROC			0x70000000
 #define HIPROC			0x7FFFFFFF
@@ -137,6 +141,9 @@ namespace gel { namespace elf {
 #define PT_LOPROC	0x70000000
 #define PT_HIPROC	0x7FFFFFFF
 
+// Extended program header number (e_phnum)
+#define PN_XNUM		0xFFFF
+
 // Segment Attributes, p_flags
 #define PF_X		0x1
 #define PF_W		0x2
@@ -186,6 +193,7 @@ namespace gel { namespace elf {
 // end no more
 
 #define DT_LOOS		0x60000000
+#define DT_GNU_HASH	0x6ffffef5	/* d_ptr */
 #define DT_HIOS		0x6fffffff
 #define DT_LOPROC	0x70000000
 #define DT_HIPROC	0x7fffffff
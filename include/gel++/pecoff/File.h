@@ -21,6 +21,7 @@
 #define GELPP_PECOFF_FILE_H_
 
 #include <gel++/File.h>
+#include <gel++/Source.h>
 
 namespace gel { namespace pecoff {
 
@@ -182,13 +183,41 @@ private:
 	File *pec;
 	string _name;
 	t::uint8 *_buf;
+	bool _own;
 	flags_t _flags;
 };
 
+class Symbol: public gel::Symbol {
+public:
+	Symbol(string name, t::uint64 value, t::uint64 size, type_t type, bind_t bind);
+	cstring name() override;
+	t::uint64 value() override;
+	t::uint64 size() override;
+	type_t type() override;
+	bind_t bind() override;
+
+private:
+	string _name;
+	t::uint64 _value, _size;
+	type_t _type;
+	bind_t _bind;
+};
+
+class SymbolTable: public gel::SymbolTable {
+public:
+	~SymbolTable();
+	void add(Symbol *sym);
+protected:
+	void collect(Vector<gel::Symbol *>& syms) const override;
+private:
+	Vector<Symbol *> _syms;
+};
+
 class File: public gel::File, public Decoder {
 	friend class Section;
 public:
 	File(Manager& manager, sys::Path path, io::RandomAccessStream *stream);
+	File(Manager& manager, sys::Path path, Source *source);
 	~File(void);
 	static bool matches(t::uint8 magic[4]);
 	
@@ -198,13 +227,15 @@ public:
 	address_t entry(void) override;
 	int count() override;
 	Segment *segment(int i) override;
+	int countSections() override;
+	gel::Section *section(int i) override;
 	Image *make(const Parameter& params) override;
 
 	string machine() const override;
 	string os() const override;
 	int elfMachine() const override;
 	int elfOS() const override;
-	const SymbolTable& symbols() override;
+	const gel::SymbolTable& symbols() override;
 
 	void fix(t::uint16& w) override;
 	void fix(t::int16& w) override;
@@ -226,7 +257,8 @@ private:
 	void move(offset_t offset);
 	cstring getString(t::uint32 offset);
 	
-	io::RandomAccessStream *stream;
+	Source *src;
+	offset_t pos;
 	coff_header_t _coff_header;
 	standard_coff_fields_t _standard_coff_fields;
 	windows_specific_fields_t _windows_specific_fields;
@@ -236,6 +268,7 @@ private:
 	char *_string_table;
 	t::uint32 _string_table_size;
 	Vector<Section *> sects;
+	SymbolTable *_symtab;
 };
 
 } } // gel::pecoff
@@ -175,12 +175,76 @@ File::File(
 {
 	if(!_reader->load(path.toString().asSysString()))
 		throw Exception(_ << "cannot open " << path);
+	init();
+}
+
+
+/**
+ * Stream buffer reading directly from a memory block.
+ */
+class MemoryBuf: public std::streambuf {
+public:
+	MemoryBuf(const void *data, gel::size_t size) {
+		char *p = const_cast<char *>(static_cast<const char *>(data));
+		setg(p, p, p + size);
+	}
+protected:
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+		char *p;
+		switch(dir) {
+		case std::ios_base::beg:	p = eback() + off; break;
+		case std::ios_base::cur:	p = gptr() + off; break;
+		default:					p = egptr() + off; break;
+		}
+		if(p < eback() || p > egptr())
+			return pos_type(off_type(-1));
+		setg(eback(), p, egptr());
+		return pos_type(p - eback());
+	}
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+		return seekoff(off_type(pos), std::ios_base::beg, which);
+	}
+};
+
+
+/**
+ * Build a COFF file from a memory block. COFFI keeps its own copy
+ * of the section data, so the block may be released after this call.
+ * @param manager	Current manager.
+ * @param name		Name of the file (used for error messages).
+ * @param data		Base address of the file block.
+ * @param size		Size of the file block.
+ */
+File::File(
+	Manager& manager,
+	sys::Path name,
+	const void *data,
+	size_t size
+):
+	gel::File(manager, name),
+	_reader(new COFFI::coffi),
+	_symtab(nullptr),
+	_debug(nullptr),
+	_debug_init(false)
+{
+	MemoryBuf buf(data, size);
+	std::istream in(&buf);
+	if(!_reader->load(in))
+		throw Exception(_ << "cannot open " << name);
+	init();
+}
+
+
+/**
+ * Build the segments and sections from the loaded file.
+ */
+void File::init() {
 
 	// get the image base
 	switch (_reader->get_architecture()) {
 		case COFFI::COFFI_ARCHITECTURE_PE:
 			if(! _reader->get_win_header())
-				throw Exception(_ << "No Windows header for " << path);
+				throw Exception(_ << "No Windows header for " << path());
 			_base = _reader->get_win_header()->get_image_base();
 			break;
 		case COFFI::COFFI_ARCHITECTURE_CEVA:
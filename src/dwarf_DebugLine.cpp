@@ -19,13 +19,18 @@
 
 #include <elm/data/util.h>
 
+#include <gel++/CompactLineTable.h>
 #include <gel++/elf/DebugLine.h>
 
+#include <atomic>
 #include <cstdlib>
+#include <memory>
+#include <system_error>
+#include <thread>
 
 namespace gel { namespace dwarf {
 
-#define DO_DEBUG
+//#define DO_DEBUG
 #define DEBUG_OUT(txt)	cerr << "DEBUG: " << txt << io::endl;
 #ifdef DO_DEBUG
 #	define DEBUG(txt)	DEBUG_OUT(txt)
@@ -104,6 +109,15 @@ namespace gel { namespace dwarf {
 #define DW_FORM_addrx2 0x2a
 #define DW_FORM_addrx3 0x2b
 #define DW_FORM_addrx4 0x2c
+
+// Attributes
+#define DW_AT_stmt_list			0x10
+
+// Unit types (DWARF-5)
+#define DW_UT_compile			0x01
+#define DW_UT_partial			0x03
+#define DW_UT_skeleton			0x04
+#define DW_UT_split_compile		0x05
 	
 	
 /**
@@ -115,19 +129,40 @@ namespace gel { namespace dwarf {
 /**
  * @class DebugLine
  * Provides access to debug source line information of an ELF file.
+ *
+ * The decoding is split in two steps. First, a sequential scan finds the
+ * boundaries of the units and reads their headers: the file tables are
+ * interned there in the order of the section. Then the line programs of the
+ * units are run in parallel, each thread recording the rows in its own
+ * buffers. Finally, the rows are merged sequentially, in the order of the
+ * units, into the compilation units: the result does not depend on the
+ * scheduling of the threads.
+ *
+ * In lazy mode (selected by Manager::LAZY_LINES when the debug lines are
+ * obtained from an open file), only the first step is performed at
+ * construction. The address ranges of the units are taken from the
+ * .debug_aranges section if available and the line programs are run only
+ * when a query needs their lines. The units not described in .debug_aranges
+ * are bounded, at the first address query, by a (parallel) scan of their
+ * line programs that does not record the lines.
  */
 
 /**
  * Build source line debug information for the given ELF file.
  * @param efile		ELF file to get information frome.
+ * @param lazy		True to decode the line programs on demand, false to
+ * 					decode them at construction.
+ * @param compact	True to store the lines in compact form
+ * 					(see gel::DebugLine).
  */
-DebugLine::DebugLine(elf::File *efile): gel::DebugLine(efile), is_64(false) {
+DebugLine::DebugLine(elf::File *efile, bool lazy, bool compact): gel::DebugLine(efile, compact) {
 
 	// get the buffer
 	auto sect = efile->findSection(".debug_line");
 	if(sect == nullptr)
 		return;
-	Cursor c(sect->buffer());
+	line_cursor = Cursor(sect->buffer());
+	Cursor c = line_cursor;
 
 	auto sect_str = efile->findSection(".debug_str");
 	if(sect_str != nullptr)
@@ -137,29 +172,50 @@ DebugLine::DebugLine(elf::File *efile): gel::DebugLine(efile), is_64(false) {
 	if(sect_line_str != nullptr)
 		line_str_sect_cursor = Cursor(sect_line_str->buffer());
 
-	// decode the content
+	// index the units
 	DEBUG("reading (size =" << c.size() << ")");
+	UnitList units;
 	while(!c.ended())
-		readCU(c);
+		readCU(c, units);
+
+	// decode the content
+	if(!lazy) {
+		decode(units, true, true);
+		for(auto u: units)
+			add(u);
+	}
+	else {
+		readARanges(efile, units);
+		for(auto u: units)
+			defer(u, u->has_ranges);
+	}
+	units.clear();
 }
 
 /**
  * Build source line debug information for the given ELF file.
  * @param file		ELF file to get information frome.
  * @param buf		Buffer to
+ * @param compact	True to store the lines in compact form
+ * 					(see gel::DebugLine).
  */
-DebugLine::DebugLine(gel::File *file, Buffer buf): gel::DebugLine(file), is_64(false) {
-	Cursor c(buf);
+DebugLine::DebugLine(gel::File *file, Buffer buf, bool compact): gel::DebugLine(file, compact), line_cursor(buf) {
+	Cursor c = line_cursor;
 	DEBUG("reading (size =" << c.size() << ")");
+	UnitList units;
 	while(!c.ended())
-		readCU(c);
+		readCU(c, units);
+	decode(units, true, true);
+	for(auto u: units)
+		add(u);
+	units.clear();
 }
 
 
 /**
  * Build source line information from a buffer.
  */
-/*DebugLine::DebugLine(Buffer& buf): gel::DebugLine(efile), is_64(false) {
+/*DebugLine::DebugLine(Buffer& buf): gel::DebugLine(efile) {
 
 }*/
 
@@ -176,31 +232,425 @@ DebugLine::DebugLine(gel::File *file, Buffer buf): gel::DebugLine(file), is_64(f
  * @return	List of compilation units.
  */
 
-void DebugLine::readCU(Cursor& c) {
-	StateMachine sm;
+/**
+ * Read the header of a unit of the .debug_line section and add the unit
+ * to the given list. The line program itself is skipped.
+ * @param c		Cursor on the unit.
+ * @param units	List to add the unit to (it owns the units until they
+ * 				are added to the debug line).
+ */
+void DebugLine::readCU(Cursor& c, UnitList& units) {
+	std::unique_ptr<Unit> u(new Unit());
 
 	// start the compilation unit
-	size_t unit_length = readUnitLength(c);
-	size_t end_offset = c.offset() + unit_length;
+	u->offset = c.offset();
+	size_t unit_length = readUnitLength(c, u->sm.is_64);
+	u->end = c.offset() + unit_length;
 	DEBUG("===> unit_length = " << unit_length
-		 << ", end offset = " << end_offset);
-	auto cu = new CompilationUnit();
+		 << ", end offset = " << u->end);
 
 	// parse the header
+	readHeader(c, u->sm, u.get());
+	DEBUG("readHeader: file = " << u->sm.file);
+	u->program = c.offset();
+	u->header_files = u->files().count();
+	u->has_ranges = false;
+	c.move(u->end);
+	units.add(u.get());
+	u.release();
+}
+
+/**
+ * Run the line programs of the given units, in parallel if there are
+ * several ones, and merge the result in the units.
+ * @param units		Units to decode.
+ * @param lines		True to record the lines.
+ * @param ranges	True to record the address ranges.
+ * @throw gel::Exception	If a line program cannot be decoded (the error of
+ * 							the first unit in error is reported and no unit
+ * 							is modified).
+ */
+void DebugLine::decode(const Vector<Unit *>& units, bool lines, bool ranges) {
+	int n = units.count();
+	if(n == 0)
+		return;
+	std::unique_ptr<std::unique_ptr<Rows>[]> rows(new std::unique_ptr<Rows>[n]);
+	for(int i = 0; i < n; i++)
+		rows[i].reset(new Rows());
+
+	// run the line programs
+	std::atomic<int> next(0);
+	auto work = [&]() {
+		for(int i = next++; i < n; i = next++)
+			try {
+				StateMachine sm = units[i]->sm;
+				sm.record_lines = lines;
+				sm.record_ranges = ranges;
+				Cursor c = line_cursor;
+				c.move(units[i]->program);
+				runSM(c, sm, *rows[i], units[i]->end);
+				if(lines)
+					check(units[i], *rows[i]);
+			}
+			catch(...) {
+				rows[i]->error = std::current_exception();
+			}
+	};
+	int tn = min(n, int(std::thread::hardware_concurrency()));
+	if(tn <= 1)
+		work();
+	else {
+		std::unique_ptr<std::thread[]> threads(new std::thread[tn - 1]);
+		int started = 0;
+		try {
+			for(; started < tn - 1; started++)
+				threads[started] = std::thread(work);
+		}
+		catch(std::system_error&) {
+			// no more thread available: go on with the running ones
+		}
+		work();
+		for(int i = 0; i < started; i++)
+			threads[i].join();
+	}
+
+	// merge the rows (releasing them as soon as they are merged)
+	for(int i = 0; i < n; i++)
+		if(rows[i]->error)
+			std::rethrow_exception(rows[i]->error);
+	for(int i = 0; i < n; i++) {
+		merge(units[i], *rows[i], lines, ranges);
+		rows[i].reset();
+	}
+}
+
+/**
+ * Check that the rows produced by the line program of a unit only refer
+ * to existing files.
+ * @param u		Unit of the line program.
+ * @param rows	Rows produced by the line program.
+ * @throw gel::Exception	If a file index is invalid.
+ */
+void DebugLine::check(Unit *u, const Rows& rows) {
+	int base = u->sm.version >= 5 ? 0 : 1;
+	int n = u->header_files + rows.files.count();
+	for(const auto& r: rows.rows) {
+		int i = int(r.file) - base;
+		if(i < 0 || i >= n)
+			throw gel::Exception(_ << "invalid file index " << r.file << " in debug line");
+	}
+}
+
+/**
+ * Merge the rows produced by the line program of a unit into the unit.
+ * The files defined by the line program (DW_LNE_define_file) are recorded
+ * the first time the program is run: a file of the header of the unit with
+ * the same path is reused, else a file private to the unit is defined (see
+ * gel::DebugLine::define()). The shared file tables are thus only modified
+ * by the sequential scan of the headers. The rows must have been checked
+ * before. In compact mode, the rows are directly encoded in a compact line
+ * table.
+ * @param u			Unit to merge in.
+ * @param rows		Rows produced by the line program.
+ * @param lines		True to merge the lines.
+ * @param ranges	True to merge the address ranges.
+ */
+void DebugLine::merge(Unit *u, const Rows& rows, bool lines, bool ranges) {
+	for(int k = u->program_files.count(); k < rows.files.count(); k++) {
+		const auto& f = rows.files[k];
+		File *file = nullptr;
+		for(int j = 0; j < u->header_files && file == nullptr; j++)
+			if(u->files()[j]->path() == f.path)
+				file = u->files()[j];
+		if(file == nullptr)
+			file = define(u, f.path, f.date, f.size);
+		u->program_files.add(file);
+	}
+	if(lines) {
+		int base = u->sm.version >= 5 ? 0 : 1;
+		if(isCompact()) {
+			auto t = new CompactLineTable();
+			CompactLineTable::Builder b(*t);
+			for(const auto& r: rows.rows)
+				b.add(LineNumber(r.addr, u->file(int(r.file) - base), r.line, r.col, r.flags, r.isa, r.disc, r.opi));
+			b.finish();
+			u->add(t);
+		}
+		else
+			for(const auto& r: rows.rows)
+				u->add(LineNumber(r.addr, u->file(int(r.file) - base), r.line, r.col, r.flags, r.isa, r.disc, r.opi));
+	}
+	if(ranges)
+		for(const auto& r: rows.ranges)
+			u->addRange(r.fst, r.snd);
+}
+
+/**
+ * Bound a unit in lazy mode by scanning its line program without
+ * recording the lines.
+ * @param cu	Unit to bound.
+ */
+void DebugLine::bound(CompilationUnit *cu) {
+	Vector<Unit *> units;
+	units.add(static_cast<Unit *>(cu));
+	decode(units, false, true);
+}
+
+/**
+ * Bound several units in lazy mode: their line programs are scanned in
+ * parallel.
+ * @param cus	Units to bound.
+ */
+void DebugLine::bound(const Vector<CompilationUnit *>& cus) {
+	Vector<Unit *> units;
+	for(auto cu: cus)
+		units.add(static_cast<Unit *>(cu));
+	decode(units, false, true);
+}
+
+/**
+ * Decode the lines of a unit in lazy mode.
+ * @param cu		Unit to decode.
+ * @param ranges	True to also record the ranges of the unit.
+ */
+void DebugLine::load(CompilationUnit *cu, bool ranges) {
+	Vector<Unit *> units;
+	units.add(static_cast<Unit *>(cu));
+	decode(units, true, ranges);
+}
+
+/**
+ * Read the address ranges of the units from the .debug_aranges section.
+ * The ranges are associated with the line program of the unit through the
+ * DW_AT_stmt_list attribute of the first DIE of the unit in .debug_info.
+ * If the section cannot be read, no range is recorded: the units will be
+ * bounded by scanning their line program.
+ * @param efile		ELF file to look in.
+ * @param units		Units of the .debug_line section (sorted by offset).
+ */
+void DebugLine::readARanges(elf::File *efile, const Vector<Unit *>& units) {
+	auto aranges_sect = efile->findSection(".debug_aranges");
+	auto info_sect = efile->findSection(".debug_info");
+	auto abbrev_sect = efile->findSection(".debug_abbrev");
+	if(aranges_sect == nullptr || info_sect == nullptr || abbrev_sect == nullptr)
+		return;
+
+	Vector<Pair<Unit *, Pair<address_t, address_t> > > found;
 	try {
-		readHeader(c, sm, cu);
-		DEBUG("readHeader: file = " << sm.file);
-		if(c.offset() < end_offset)
-			runSM(c, sm, cu, end_offset);
+		Cursor c(aranges_sect->buffer()), info(info_sect->buffer()), abbrev(abbrev_sect->buffer());
+		while(!c.ended()) {
+
+			// read the set header
+			size_t start = c.offset();
+			bool is_64;
+			size_t length = readUnitLength(c, is_64);
+			size_t end = c.offset() + length;
+			t::uint16 version;
+			error_if(!c.read(version));
+			offset_t info_offset = readAddress(c, is_64);
+			t::uint8 address_size, segment_size;
+			error_if(!c.read(address_size));
+			error_if(!c.read(segment_size));
+			size_t tuple_size = 2 * address_size + segment_size;
+			error_if(tuple_size == 0);
+
+			// find the line program
+			Unit *u = nullptr;
+			offset_t stmt;
+			if(readStmtList(info, abbrev, info_offset, stmt)) {
+				int l = 0, h = units.count();
+				while(l < h) {
+					int m = (l + h) / 2;
+					if(units[m]->offset < stmt)
+						l = m + 1;
+					else
+						h = m;
+				}
+				if(l < units.count() && units[l]->offset == stmt)
+					u = units[l];
+			}
+
+			// read the ranges
+			size_t rem = (c.offset() - start) % tuple_size;
+			if(rem != 0)
+				c.skip(tuple_size - rem);
+			while(c.offset() + tuple_size <= end) {
+				error_if(!c.skip(segment_size));
+				address_t addr = readSized(c, address_size);
+				t::uint64 size = readSized(c, address_size);
+				if(addr == 0 && size == 0)
+					break;
+				if(u != nullptr && size != 0)
+					found.add(pair(u, pair(addr, address_t(addr + size))));
+			}
+			c.move(end);
+		}
 	}
 	catch(gel::Exception& e) {
-		delete cu;
-		throw e;
+		DEBUG("cannot read .debug_aranges: " << e.message());
+		return;
 	}
 
-	// finalize
-	add(cu);
-	c.move(end_offset);
+	// record the ranges
+	for(const auto& f: found) {
+		f.fst->addRange(f.snd.fst, f.snd.snd);
+		f.fst->has_ranges = true;
+	}
+}
+
+/**
+ * Get the offset in .debug_line of the line program of a unit of
+ * .debug_info, that is, the value of the DW_AT_stmt_list attribute of the
+ * first DIE of the unit.
+ * @param info		Cursor on .debug_info.
+ * @param abbrev	Cursor on .debug_abbrev.
+ * @param offset	Offset of the unit in .debug_info.
+ * @param stmt		Set to the line program offset.
+ * @return			True if the line program offset is found, false else.
+ */
+bool DebugLine::readStmtList(Cursor info, Cursor abbrev, offset_t offset, offset_t& stmt) {
+
+	// read the unit header
+	error_if(!info.move(offset));
+	bool is_64;
+	readUnitLength(info, is_64);
+	t::uint16 version;
+	error_if(!info.read(version));
+	t::uint8 address_size;
+	offset_t abbrev_offset;
+	if(version >= 5) {
+		t::uint8 type;
+		error_if(!info.read(type));
+		error_if(!info.read(address_size));
+		abbrev_offset = readAddress(info, is_64);
+		if(type == DW_UT_skeleton || type == DW_UT_split_compile)
+			error_if(!info.skip(8));
+		else if(type != DW_UT_compile && type != DW_UT_partial)
+			return false;
+	}
+	else {
+		abbrev_offset = readAddress(info, is_64);
+		error_if(!info.read(address_size));
+	}
+	t::uint64 code = readLEB128U(info);
+
+	// look for the abbreviation of the first DIE
+	error_if(!abbrev.move(abbrev_offset));
+	while(true) {
+		t::uint64 acode = readLEB128U(abbrev);
+		if(acode == 0)
+			return false;
+		readLEB128U(abbrev);
+		t::uint8 children;
+		error_if(!abbrev.read(children));
+		if(acode == code)
+			break;
+		while(true) {
+			t::uint64 name = readLEB128U(abbrev), form = readLEB128U(abbrev);
+			if(form == DW_FORM_implicit_const)
+				readLEB128S(abbrev);
+			if(name == 0 && form == 0)
+				break;
+		}
+	}
+
+	// look for DW_AT_stmt_list
+	while(true) {
+		t::uint64 name = readLEB128U(abbrev), form = readLEB128U(abbrev);
+		if(form == DW_FORM_implicit_const)
+			readLEB128S(abbrev);
+		if(name == 0 && form == 0)
+			return false;
+		if(name == DW_AT_stmt_list)
+			switch(form) {
+			case DW_FORM_sec_offset:	stmt = readAddress(info, is_64); return true;
+			case DW_FORM_data4:			stmt = readSized(info, 4); return true;
+			case DW_FORM_data8:			stmt = readSized(info, 8); return true;
+			default:					return false;
+			}
+		skipForm(info, form, version, address_size, is_64);
+	}
+}
+
+/**
+ * Skip an attribute value in .debug_info.
+ * @param c			Cursor on the value.
+ * @param form		Form of the value.
+ * @param version	DWARF version of the unit.
+ * @param addr_size	Size of addresses in the unit.
+ * @param is_64		True for 64-bit DWARF format.
+ */
+void DebugLine::skipForm(Cursor& c, t::uint64 form, int version, int addr_size, bool is_64) {
+	size_t offset_size = is_64 ? 8 : 4;
+	switch(form) {
+	case DW_FORM_flag_present:
+	case DW_FORM_implicit_const:
+		break;
+	case DW_FORM_addr:
+		error_if(!c.skip(addr_size));
+		break;
+	case DW_FORM_data1: case DW_FORM_ref1: case DW_FORM_flag:
+	case DW_FORM_strx1: case DW_FORM_addrx1:
+		error_if(!c.skip(1));
+		break;
+	case DW_FORM_data2: case DW_FORM_ref2: case DW_FORM_strx2: case DW_FORM_addrx2:
+		error_if(!c.skip(2));
+		break;
+	case DW_FORM_strx3: case DW_FORM_addrx3:
+		error_if(!c.skip(3));
+		break;
+	case DW_FORM_data4: case DW_FORM_ref4: case DW_FORM_ref_sup4:
+	case DW_FORM_strx4: case DW_FORM_addrx4:
+		error_if(!c.skip(4));
+		break;
+	case DW_FORM_data8: case DW_FORM_ref8: case DW_FORM_ref_sig8: case DW_FORM_ref_sup8:
+		error_if(!c.skip(8));
+		break;
+	case DW_FORM_data16:
+		error_if(!c.skip(16));
+		break;
+	case DW_FORM_sdata:
+		readLEB128S(c);
+		break;
+	case DW_FORM_udata: case DW_FORM_ref_udata: case DW_FORM_strx: case DW_FORM_addrx:
+	case DW_FORM_loclistx: case DW_FORM_rnglistx:
+		readLEB128U(c);
+		break;
+	case DW_FORM_strp: case DW_FORM_line_strp: case DW_FORM_sec_offset: case DW_FORM_strp_sup:
+		error_if(!c.skip(offset_size));
+		break;
+	case DW_FORM_ref_addr:
+		error_if(!c.skip(version <= 2 ? addr_size : offset_size));
+		break;
+	case DW_FORM_string: {
+			cstring s;
+			error_if(!c.read(s));
+		}
+		break;
+	case DW_FORM_block1: {
+			t::uint8 s;
+			error_if(!c.read(s) || !c.skip(s));
+		}
+		break;
+	case DW_FORM_block2: {
+			t::uint16 s;
+			error_if(!c.read(s) || !c.skip(s));
+		}
+		break;
+	case DW_FORM_block4: {
+			t::uint32 s;
+			error_if(!c.read(s) || !c.skip(s));
+		}
+		break;
+	case DW_FORM_block: case DW_FORM_exprloc:
+		error_if(!c.skip(readLEB128U(c)));
+		break;
+	case DW_FORM_indirect:
+		skipForm(c, readLEB128U(c), version, addr_size, is_64);
+		break;
+	default:
+		throw gel::Exception(_ << "unknown DWARF form " << io::hex(form));
+	}
 }
 
 void DebugLine::readHeader(Cursor& c, StateMachine& sm, CompilationUnit *cu) {
@@ -219,7 +669,7 @@ void DebugLine::readHeader(Cursor& c, StateMachine& sm, CompilationUnit *cu) {
 	}
 	
 	// read header length
-	size_t header_length = readHeaderLength(c);
+	size_t header_length = readHeaderLength(c, sm);
 	size_t lines = c.offset() + header_length;
 	DEBUG("header length = " << header_length);
 
@@ -236,7 +686,8 @@ void DebugLine::readHeader(Cursor& c, StateMachine& sm, CompilationUnit *cu) {
 	t::uint8 default_is_stmt;
 	c.read(default_is_stmt);
 	if(default_is_stmt)
-		sm.set(LineNumber::IS_STMT);
+		sm.default_flags = LineNumber::IS_STMT;
+	sm.flags = sm.default_flags;
 	DEBUG("default_is_stmt = " << sm.bit(LineNumber::IS_STMT));
 	c.read(sm.line_base);
 	DEBUG("line base = " << sm.line_base);
@@ -264,10 +715,8 @@ void DebugLine::readHeader(Cursor& c, StateMachine& sm, CompilationUnit *cu) {
 	c.move(lines);
 }
 
-void DebugLine::runSM(Cursor& c, StateMachine& sm, CompilationUnit *cu, size_t end) {
-	while(!sm.end_sequence) {
-		if(c.offset() >= end)
-			throw gel::Exception("endless debug line opcode program");
+void DebugLine::runSM(Cursor& c, StateMachine& sm, Rows& rows, size_t end) {
+	while(c.offset() < end) {
 		t::uint8 opcode;
 		error_if(!c.read(opcode));
 		DEBUG("@0x" << io::hex(c.offset()-1) << " " << opcode);
@@ -277,19 +726,19 @@ void DebugLine::runSM(Cursor& c, StateMachine& sm, CompilationUnit *cu, size_t e
 			opcode -= sm.opcode_base;
 			DEBUG("opcode=" << opcode << ", line_base=" << sm.line_base << ", line_range=" << sm.line_range);
 			advanceLine(sm, sm.line_base + (opcode % sm.line_range));
-			advancePC(sm, cu, opcode / sm.line_range);
-			recordLine(sm, cu);
+			advancePC(sm, opcode / sm.line_range);
+			recordLine(sm, rows);
 		}
 
 		// standard and extended
 		else
 			switch(opcode) {
 			case DW_LNS_copy:
-				recordLine(sm, cu);
+				recordLine(sm, rows);
 				DEBUG("Copy")
 				break;
 			case DW_LNS_advance_pc:
-				advancePC(sm, cu, readLEB128U(c));
+				advancePC(sm, readLEB128U(c));
 				break;
 			case DW_LNS_advance_line: {
 					auto l = readLEB128S(c);
@@ -315,7 +764,7 @@ void DebugLine::runSM(Cursor& c, StateMachine& sm, CompilationUnit *cu, size_t e
 				sm.set(LineNumber::BASIC_BLOCK);
 				break;
 			case DW_LNS_const_add_pc:
-				advancePC(sm, cu, (255 - sm.opcode_base) / sm.line_range);
+				advancePC(sm, (255 - sm.opcode_base) / sm.line_range);
 				break;
 			case DW_LNS_fixed_advance_pc: {
 					t::uint16 o;
@@ -341,15 +790,26 @@ void DebugLine::runSM(Cursor& c, StateMachine& sm, CompilationUnit *cu, size_t e
 					DEBUG("extended " << opcode);
 					switch(opcode) {
 					case DW_LNE_end_sequence:
-						recordLine(sm, cu);
 						sm.end_sequence = true;
+						sm.set(LineNumber::END_SEQUENCE);
+						recordLine(sm, rows);
+						if(sm.record_ranges)
+							rows.ranges.add(pair(sm.sequence_base, sm.address));
+						sm.reset();
 						break;
 					case DW_LNE_set_address:
-						sm.address = readAddress(c);
+						sm.address = readSized(c, offset - c.offset());
+						sm.op_index = 0;
 						DEBUG("Set address to 0x" << io::hex(sm.address))
 						break;
 					case DW_LNE_define_file:
-						readFile(c, sm, cu);
+						if(sm.record_lines) {
+							cstring name;
+							error_if(!c.read(name));
+							Rows::file_t f;
+							f.path = readFileEntry(c, sm, name, f.date, f.size);
+							rows.files.add(f);
+						}
 						break;
 					case DW_LNE_set_discriminator:
 						sm.discriminator = readLEB128U(c);
@@ -365,9 +825,13 @@ void DebugLine::runSM(Cursor& c, StateMachine& sm, CompilationUnit *cu, size_t e
 				throw gel::Exception("invalid debug line standard opcode");
 			}
 	}
+
+	// close a sequence lacking its end
+	if(sm.in_sequence && sm.record_ranges)
+		rows.ranges.add(pair(sm.sequence_base, sm.address));
 }
 
-void DebugLine::advancePC(StateMachine& sm, CompilationUnit *cu, t::uint64 adv) {
+void DebugLine::advancePC(StateMachine& sm, t::uint64 adv) {
 	if(sm.maximum_operations_per_instruction == 1)
 		sm.address += sm.minimum_instruction_length * adv;
 	else {
@@ -380,43 +844,65 @@ void DebugLine::advanceLine(StateMachine& sm, t::int64 adv) {
 	sm.line += adv;
 }
 
-void DebugLine::recordLine(StateMachine& sm, CompilationUnit *cu) {
-	DEBUG("file = " << sm.file);
-	File *file = cu->files()[sm.file - 1];
-	DEBUG("line "
-		<< io::hex(sm.address) << " "
-		<< file->path() << ":"
-		<< sm.line << ":" << sm.column);
+void DebugLine::recordLine(StateMachine& sm, Rows& rows) {
+	if(!sm.in_sequence) {
+		sm.in_sequence = true;
+		sm.sequence_base = sm.address;
+	}
 
 	// record the line
-	cu->add(LineNumber(sm.address, file, sm.line,
-			sm.column, sm.flags, sm.isa, sm.discriminator, sm.op_index));
+	if(sm.record_lines) {
+		DEBUG("line "
+			<< io::hex(sm.address) << " "
+			<< sm.file << ":"
+			<< sm.line << ":" << sm.column);
+		Rows::row_t r;
+		r.addr = sm.address;
+		r.file = sm.file;
+		r.line = sm.line;
+		r.col = sm.column;
+		r.flags = sm.flags;
+		r.isa = sm.isa;
+		r.disc = sm.discriminator;
+		r.opi = sm.op_index;
+		rows.rows.add(r);
+	}
 
 	// update the SM
-	sm.set(LineNumber::BASIC_BLOCK | LineNumber::PROLOGUE_END | LineNumber::EPILOGUE_BEGIN);
+	sm.clear(LineNumber::BASIC_BLOCK | LineNumber::PROLOGUE_END | LineNumber::EPILOGUE_BEGIN);
 	sm.discriminator = 0;
 }
 
+/**
+ * Read the end of a file entry (before DWARF-5): directory index,
+ * modification date and size.
+ * @param c		Cursor on the entry, after the name.
+ * @param sm	Current state machine.
+ * @param name	Name of the file.
+ * @param date	Set to the modification date.
+ * @param size	Set to the file size.
+ * @return		Path of the file.
+ */
+sys::Path DebugLine::readFileEntry(Cursor& c, StateMachine& sm, cstring name, t::uint64& date, t::uint64& size) {
+	auto dir = readLEB128U(c);
+	date = readLEB128U(c);
+	size = readLEB128U(c);
+	DEBUG("file = " << name << ", " << dir << ", " << date << ", " << size);
+	if(dir == 0)
+		return sys::Path(".") / sys::Path(name);
+	error_if(dir >= t::uint64(sm.include_directories.count()));
+	DEBUG(dir << ":" << sm.include_directories[dir]);
+	return sys::Path(sm.include_directories[dir]) / name;
+}
+
 void DebugLine::readFile(Cursor& c, StateMachine& sm, CompilationUnit *cu) {
 	if(sm.version < 5) {
 		cstring s;
 		error_if(!c.read(s));
 		while(s != "") {
-			auto dir = readLEB128U(c);
-			auto date = readLEB128U(c);
-			auto size = readLEB128U(c);
-			DEBUG("file = " << s << ", " << dir << ", " << date << ", " << size);
-			sys::Path p;
-			if(dir == 0) {
-				p = sys::Path(".") / sys::Path(s);
-				DEBUG("no dire: " << p );
-			}
-			else {
-				DEBUG(dir << ":" << sm.include_directories[dir]);
-				p = sys::Path(sm.include_directories[dir]) / s;
-				DEBUG("p = " << p);
-			}
-			DEBUG("p = " << (void *)&p << ":");
+			t::uint64 date, size;
+			sys::Path p = readFileEntry(c, sm, s, date, size);
+			DEBUG("p = " << p);
 			File *f = files().get(p, nullptr);
 			if(f == nullptr) {
 				f = new File(p, date, size);
@@ -453,12 +939,12 @@ void DebugLine::readFile(Cursor& c, StateMachine& sm, CompilationUnit *cu) {
 						c.read(file_name);
 					}
 					else if(format_codes[iformat] == DW_FORM_line_strp) {
-						size_t offset = readAddress(c);
+						size_t offset = readAddress(c, sm.is_64);
 						line_str_sect_cursor.move(offset);
 						line_str_sect_cursor.read(file_name);
 					}
 					else if(format_codes[iformat] == DW_FORM_strp) {
-						size_t offset = readAddress(c);
+						size_t offset = readAddress(c, sm.is_64);
 						str_sect_cursor.move(offset);
 						str_sect_cursor.read(file_name);
 					}
@@ -498,8 +984,8 @@ void DebugLine::readFile(Cursor& c, StateMachine& sm, CompilationUnit *cu) {
 	}
 }
 
-size_t DebugLine::readHeaderLength(Cursor& c) {
-	if(!is_64) {
+size_t DebugLine::readHeaderLength(Cursor& c, StateMachine& sm) {
+	if(!sm.is_64) {
 		t::uint32 l;
 		c.read(l);
 		return l;
@@ -511,7 +997,7 @@ size_t DebugLine::readHeaderLength(Cursor& c) {
 	}
 }
 
-size_t DebugLine::readUnitLength(Cursor& c) {
+size_t DebugLine::readUnitLength(Cursor& c, bool& is_64) {
 	t::uint32 l;
 	error_if(!c.read(l));
 	if(l < 0xffffff00) {
@@ -550,7 +1036,23 @@ t::uint64 DebugLine::readLEB128U(Cursor& c) {
 	return r;
 }
 
-address_t DebugLine::readAddress(Cursor& c) {
+/**
+ * Read an unsigned integer of the given size.
+ * @param c		Cursor to read from.
+ * @param size	Size of the integer (1, 2, 4 or 8).
+ * @return		Read integer.
+ */
+t::uint64 DebugLine::readSized(Cursor& c, size_t size) {
+	switch(size) {
+	case 1:	{ t::uint8 v; error_if(!c.read(v)); return v; }
+	case 2:	{ t::uint16 v; error_if(!c.read(v)); return v; }
+	case 4:	{ t::uint32 v; error_if(!c.read(v)); return v; }
+	case 8:	{ t::uint64 v; error_if(!c.read(v)); return v; }
+	default: throw gel::Exception(_ << "unsupported integer size " << size);
+	}
+}
+
+address_t DebugLine::readAddress(Cursor& c, bool is_64) {
 	if(!is_64) {
 		t::uint32 a;
 		error_if(!c.read(a));
@@ -607,13 +1109,13 @@ void DebugLine::readDir(Cursor &c, StateMachine &sm) {
 					}
 					else if(format_codes[iformat] == DW_FORM_line_strp) {
 						//check in .debug_line_str
-						size_t offset = readAddress(c);
+						size_t offset = readAddress(c, sm.is_64);
 						line_str_sect_cursor.move(offset);
 						line_str_sect_cursor.read(dir_name);
 					}
 					else if(format_codes[iformat] == DW_FORM_strp) {
 						//check in .debug_str
-						size_t offset = readAddress(c);
+						size_t offset = readAddress(c, sm.is_64);
 						str_sect_cursor.move(offset);
 						str_sect_cursor.read(dir_name);
 					}
@@ -17,9 +17,15 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include "config.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
 #include <elm/array.h>
 #include <gel++/elf/defs.h>
+#include <gel++/elf/defs64.h>
 #include <gel++/elf/File.h>
+#include <gel++/elf/Reader.h>
 #include <gel++/elf/UnixBuilder.h>
 #include <gel++/elf/DebugLine.h>
 #include <gel++/Image.h>
@@ -50,6 +56,7 @@ public:
 	bool isWritable()		override { return _head->flags() & PF_W; }
 	bool hasContent()		override { return true; }
 	Buffer buffer()			override { return _head->content(); }
+	Buffer fileBuffer()		override { return _head->fileContent(); }
 
 private:
 	cstring _name;
@@ -57,9 +64,27 @@ private:
 };
 
 
+// hash tables of the dynamic symbols and found symbols
+class File::DynLookup {
+public:
+	inline DynLookup(): gnu(0), hash(0), symtab(0), strtab(0), strsz(0), syment(0) { }
+	inline ~DynLookup() { for(auto s: found) delete s; }
+	offset_t gnu, hash, symtab, strtab;
+	size_t strsz, syment;
+	HashMap<string, Symbol *> found;	// null for absent symbols
+	std::mutex mutex;					// protects found
+};
+
+
 /**
  * @class File
  * Class handling executable file in ELF format (32-bits).
+ *
+ * The tables of the file (sections, program headers, symbols, debug lines)
+ * and the content of sections and program headers are built on first access
+ * and published only once. Therefore, as soon as the source supports concurrent
+ * reads (see Manager::CONCURRENT), a file can be queried in parallel from
+ * several threads without further synchronization.
  * @ingroup elf
  */
 
@@ -99,30 +124,50 @@ bool File::matches(t::uint8 magic[4]) {
  * @param stream	Stream to read from.
  */
 File::File(Manager& manager, sys::Path path, io::RandomAccessStream *stream)
+:	File(manager, path, new StreamSource(path, stream))
+{
+}
+
+/**
+ * Constructor from a generic source.
+ * @param manager	Parent manager.
+ * @param path		File path.
+ * @param source	Source to read from (ownership is transferred to the file).
+ */
+File::File(Manager& manager, sys::Path path, Source *source)
 :	gel::File(manager, path),
-	s(stream),
+	src(source),
 	id(nullptr),
 	ph_loaded(false),
 	sects_loaded(false),
+	sect_cnt(0),
+	sect_tab(nullptr),
+	sects_all(false),
 	str_tab(nullptr),
 	syms(nullptr),
 	segs_init(false),
-	debug(nullptr)
+	debug(nullptr),
+	compact_lines(false),
+	lazy_lines(false),
+	dlookup(nullptr)
 {
 }
 
 /**
  */
 File::~File(void) {
-	delete s;
+	delete static_cast<dwarf::DebugLine *>(debug.load());
 	if(syms != nullptr)
-		delete syms;
-	for(auto s: sects)
-		delete s;
+		delete syms.load();
+	delete dlookup.load();
+	for(int i = 0; i < sect_cnt; i++)
+		delete sect_tab[i].load();
+	delete [] sect_tab;
 	for(auto p: phs)
 		delete p;
 	for(auto s: segs)
 		delete s;
+	delete src;
 }
 
 /**
@@ -130,26 +175,340 @@ File::~File(void) {
  * @return	Map of symbols.
  */
 const gel::SymbolTable& File::symbols() {
-	if(syms == nullptr) {
-		syms = new SymbolTable();
-		initSections();
-		for(auto s: sects) {
-			if(s->type() == SHT_SYMTAB || s->type() == SHT_DYNSYM)
-				fillSymbolTable(*syms, s);
+	SymbolTable *t = syms.load(std::memory_order_acquire);
+	if(t == nullptr) {
+		std::lock_guard<std::recursive_mutex> guard(lock);
+		t = syms.load(std::memory_order_relaxed);
+		if(t == nullptr) {
+			t = new SymbolTable();
+			try {
+				Vector<Section *> tabs;
+				for(int i = 0; i < sectionCount(); i++) {
+					shdr_t h;
+					fetchSection(i, h);
+					if(h.type == SHT_SYMTAB || h.type == SHT_DYNSYM)
+						tabs.add(sectionAt(i));
+				}
+				int n = 0;
+				for(auto s: tabs)
+					if(s->entsize() != 0)
+						n += s->size() / s->entsize();
+				t->reserve(n);
+				for(auto s: tabs)
+					fillSymbolTable(*t, s);
+			}
+			catch(Exception&) {
+				delete t;
+				throw;
+			}
+			syms.store(t, std::memory_order_release);
+		}
+	}
+	return *t;
+}
+
+// symbol found by lookupDynamic()
+class DynSymbol: public Symbol {
+public:
+	inline DynSymbol(string name, t::uint64 value, t::uint64 size, t::uint8 info, t::uint16 shndx)
+		: Symbol(""), _str(name), _value(value), _size(size), _info(info), _shndx(shndx)
+		{ _name = _str.toCString(); }
+	t::uint8 elfBind()	override { return ELF32_ST_BIND(_info); }
+	t::uint8 elfType()	override { return ELF32_ST_TYPE(_info); }
+	int shndx()			override { return _shndx; }
+	t::uint64 value()	override { return _value; }
+	t::uint64 size()	override { return _size; }
+private:
+	string _str;
+	t::uint64 _value, _size;
+	t::uint8 _info;
+	t::uint16 _shndx;
+};
+
+// GNU hash function
+static t::uint32 gnuHash(cstring name) {
+	t::uint32 h = 5381;
+	for(const char *p = name.chars(); *p != '\0'; p++)
+		h = h * 33 + t::uint8(*p);
+	return h;
+}
+
+// System V hash function
+static t::uint32 sysvHash(cstring name) {
+	t::uint32 h = 0;
+	for(const char *p = name.chars(); *p != '\0'; p++) {
+		h = (h << 4) + t::uint8(*p);
+		t::uint32 g = h & 0xf0000000;
+		if(g != 0)
+			h ^= g >> 24;
+		h &= ~g;
+	}
+	return h;
+}
+
+/**
+ * Get the information to look up dynamic symbols, building it
+ * from the dynamic section on the first call.
+ * @return	Dynamic lookup information.
+ */
+File::DynLookup& File::dynLookup() {
+	DynLookup *d = dlookup.load(std::memory_order_acquire);
+	if(d == nullptr) {
+		std::lock_guard<std::recursive_mutex> guard(lock);
+		d = dlookup.load(std::memory_order_relaxed);
+		if(d == nullptr) {
+			d = new DynLookup();
+			try {
+				int di = findSectionOfType(SHT_DYNAMIC);
+				Section *dsec = di < 0 ? nullptr : sectionAt(di);
+				if(dsec != nullptr && dsec->entsize() != 0) {
+					address_t gnu = 0, hash = 0, symtab = 0, strtab = 0;
+					for(const auto& e: dyns(dsec))
+						switch(e.tag) {
+						case DT_GNU_HASH:	gnu = e.un.ptr; break;
+						case DT_HASH:		hash = e.un.ptr; break;
+						case DT_SYMTAB:		symtab = e.un.ptr; break;
+						case DT_STRTAB:		strtab = e.un.ptr; break;
+						case DT_STRSZ:		d->strsz = e.un.val; break;
+						case DT_SYMENT:		d->syment = e.un.val; break;
+						default:			break;
+						}
+					size_t min_syment = id[EI_CLASS] == ELFCLASS64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+					if(d->syment < min_syment
+					|| !addressToOffset(symtab, d->symtab)
+					|| !addressToOffset(strtab, d->strtab))
+						d->syment = 0;
+					else {
+						if(gnu != 0 && !addressToOffset(gnu, d->gnu))
+							d->gnu = 0;
+						if(hash != 0 && !addressToOffset(hash, d->hash))
+							d->hash = 0;
+					}
+				}
+			}
+			catch(Exception&) {
+				delete d;
+				throw;
+			}
+			dlookup.store(d, std::memory_order_release);
+		}
+	}
+	return *d;
+}
+
+/**
+ * Convert an address of the program into a position in the file
+ * using the loaded program headers.
+ * @param a		Address to convert.
+ * @param off	Set to the matching position in the file.
+ * @return		True if the address is backed by the file, false else.
+ */
+bool File::addressToOffset(address_t a, offset_t& off) {
+	for(auto ph: programHeaders())
+		if(ph->type() == PT_LOAD && ph->vaddr() <= a && a - ph->vaddr() < ph->filesz()) {
+			off = ph->offset() + (a - ph->vaddr());
+			return true;
+		}
+	return false;
+}
+
+/**
+ * Test if the null-terminated string at the given position in the file
+ * is equal to the given name.
+ * @param pos	Position of the string in the file.
+ * @param max	Maximum size available for the string.
+ * @param name	Name to compare with.
+ * @return		True if both strings are equal.
+ */
+bool File::matchString(offset_t pos, size_t max, cstring name) {
+	size_t l = name.length() + 1;
+	if(l > max)
+		return false;
+	const t::uint8 *p = mapAt(pos, l);
+	if(p != nullptr)
+		return std::memcmp(p, name.chars(), l) == 0;
+	t::uint8 small[256];
+	t::uint8 *b = l <= sizeof(small) ? small : new t::uint8[l];
+	bool r;
+	try {
+		readAt(pos, b, l);
+		r = std::memcmp(b, name.chars(), l) == 0;
+	}
+	catch(Exception&) {
+		if(b != small)
+			delete [] b;
+		throw;
+	}
+	if(b != small)
+		delete [] b;
+	return r;
+}
+
+/**
+ * Look for a dynamic symbol using the hash tables of the file (DT_GNU_HASH
+ * or, as a fallback, DT_HASH). Only the few entries of the hash tables, of
+ * .dynsym and of .dynstr involved in the lookup are read: the symbol table
+ * of the file is not built. With DT_GNU_HASH, most absent names are rejected
+ * by the Bloom filter without reading any symbol.
+ *
+ * The results, found or not, are cached by the file and the found symbols
+ * remain valid as long as the file. As the hash tables are not modified,
+ * concurrent lookups only synchronize to access the cache.
+ * @param name	Name of the looked symbol.
+ * @return		Found symbol or null (symbol not found, undefined symbol or no hash table).
+ * @throw gel::Exception	If there is a read error.
+ */
+Symbol *File::lookupDynamic(cstring name) {
+	DynLookup& d = dynLookup();
+	if(d.syment == 0 || (d.gnu == 0 && d.hash == 0))
+		return nullptr;
+	{
+		std::lock_guard<std::mutex> guard(d.mutex);
+		if(d.found.hasKey(name))
+			return d.found.get(name, nullptr);
+	}
+
+	// look in the hash tables
+	sym_t sym;
+	Symbol *r = nullptr;
+	if(findDynamic(d, name, sym))
+		r = new DynSymbol(name, sym.value, sym.size, sym.info, sym.shndx);
+
+	// record the result (unless another thread did it in the meantime)
+	std::lock_guard<std::mutex> guard(d.mutex);
+	if(d.found.hasKey(name)) {
+		delete r;
+		return d.found.get(name, nullptr);
+	}
+	d.found.put(name, r);
+	return r;
+}
+
+
+/**
+ * Walk the hash tables to find a defined dynamic symbol.
+ * @param d		Dynamic lookup information.
+ * @param name	Name of the looked symbol.
+ * @param sym	Set to the found symbol entry.
+ * @return		True if the symbol is found, false else.
+ * @throw gel::Exception	If there is a read error.
+ */
+bool File::findDynamic(DynLookup& d, cstring name, sym_t& sym) {
+
+	// look for the symbol index
+	t::uint32 index = 0;
+	t::uint8 entry[sizeof(Elf64_Sym)];
+	bool found = false;
+	if(d.gnu != 0) {
+		t::uint32 hd[4];
+		readAt(d.gnu, hd, sizeof(hd));
+		for(auto& w: hd)
+			decode(w);
+		t::uint32 nbuckets = hd[0], symoffset = hd[1], bloom_size = hd[2], bloom_shift = hd[3];
+		if(nbuckets == 0 || bloom_size == 0)
+			return false;
+		t::uint32 h = gnuHash(name);
+
+		// Bloom filter
+		bool is64 = id[EI_CLASS] == ELFCLASS64;
+		t::uint32 c = is64 ? 64 : 32;
+		offset_t bloom = d.gnu + sizeof(hd);
+		t::uint64 word;
+		t::uint32 i = (h / c) % bloom_size;
+		if(is64) {
+			readAt(bloom + i * 8, &word, 8);
+			decode(word);
+		}
+		else {
+			t::uint32 w;
+			readAt(bloom + i * 4, &w, 4);
+			decode(w);
+			word = w;
+		}
+		t::uint64 mask = (t::uint64(1) << (h % c)) | (t::uint64(1) << ((h >> bloom_shift) % c));
+		if((word & mask) != mask)
+			return false;
+
+		// bucket and chain
+		offset_t buckets = bloom + t::uint64(bloom_size) * (c / 8);
+		offset_t chains = buckets + t::uint64(nbuckets) * 4;
+		t::uint32 s;
+		readAt(buckets + (h % nbuckets) * 4, &s, 4);
+		decode(s);
+		if(s < symoffset)
+			return false;
+		while(!found) {
+			t::uint32 h2;
+			readAt(chains + t::uint64(s - symoffset) * 4, &h2, 4);
+			decode(h2);
+			if((h | 1) == (h2 | 1)) {
+				readAt(d.symtab + t::uint64(s) * d.syment, entry, is64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym));
+				fetchSym(entry, sym);
+				if(sym.name < d.strsz && matchString(d.strtab + sym.name, d.strsz - sym.name, name)) {
+					index = s;
+					found = true;
+				}
+			}
+			if((h2 & 1) != 0)
+				break;
+			s++;
+		}
+	}
+
+	else {
+		t::uint32 hd[2];
+		readAt(d.hash, hd, sizeof(hd));
+		for(auto& w: hd)
+			decode(w);
+		t::uint32 nbucket = hd[0], nchain = hd[1];
+		if(nbucket == 0)
+			return false;
+		offset_t buckets = d.hash + sizeof(hd);
+		offset_t chains = buckets + t::uint64(nbucket) * 4;
+		t::uint32 s;
+		readAt(buckets + (sysvHash(name) % nbucket) * 4, &s, 4);
+		decode(s);
+		for(t::uint32 n = 0; s != 0 && s < nchain && n < nchain; n++) {
+			readAt(d.symtab + t::uint64(s) * d.syment, entry, id[EI_CLASS] == ELFCLASS64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym));
+			fetchSym(entry, sym);
+			if(sym.name < d.strsz && matchString(d.strtab + sym.name, d.strsz - sym.name, name)) {
+				index = s;
+				found = true;
+				break;
+			}
+			readAt(chains + t::uint64(s) * 4, &s, 4);
+			decode(s);
 		}
 	}
-	return *syms;
+
+	return found && index != 0 && sym.shndx != SHN_UNDEF;
 }
 
+
+/**
+ * @fn void File::prefetchHeaders();
+ * Ask the source to fetch in one operation the program headers and, in one
+ * operation too, the section headers with the block preceding them (where
+ * linkers usually put the section name table). Combined with a CachedSource,
+ * this avoids many small reads when only the headers of the file are needed.
+ * @throw gel::Exception	If there is a file read error.
+ */
+
+// size of the block fetched before section headers to get the section names
+const size_t File::shstrtab_guess = 4096;
+
 /**
  * Get the program headers.
  * @return	Program headers.
  * @throw gel::Exception	If there is a file read error.
  */
 Vector<ProgramHeader *>& File::programHeaders(void) {
-	if(!ph_loaded) {
-		loadProgramHeaders(phs);
-		ph_loaded = true;
+	if(!ph_loaded.load(std::memory_order_acquire)) {
+		std::lock_guard<std::recursive_mutex> guard(lock);
+		if(!ph_loaded.load(std::memory_order_relaxed)) {
+			loadProgramHeaders(phs);
+			ph_loaded.store(true, std::memory_order_release);
+		}
 	}
 	return phs;
 }
@@ -173,35 +532,60 @@ cstring File::stringAt(t::uint64 offset) {
  * @throw gel::Exception	If there is a file read error or offset is out of bound.
  */
 cstring File::stringAt(t::uint64 offset, int sect) {
-	if(sect >= sections().length())
+	if(sect < 0 || sect >= sectionCount())
 		throw gel::Exception(_ << "strtab index out of bound");
 	cstring r;
-	sects[sect]->content().get(offset, r);
+	sectionAt(sect)->content().get(offset, r);
 	return r;
 }
 
 
 /**
- * Read from the file and throw an exception if there is an error.
+ * Read a block at a particular position. Positions and sizes are 64-bit
+ * in order to support files bigger than 4 GiB.
+ * @param pos	Position in file.
  * @param buf	Buffer to fill in.
  * @param size	Size of the buffer.
+ * @throw gel::Exception	If the block is out of the file or cannot be read.
  */
-void File::read(void *buf, t::uint32 size) {
-	if(t::uint32(s->read(buf, size)) != size)
-		throw Exception(_ << "cannot read " << size << " bytes from " << path() << ": " << s->io::InStream::lastErrorMessage());
+void File::readAt(offset_t pos, void *buf, size_t size) {
+	size_t fsize = src->size();
+	if(pos > fsize || size > fsize - pos)
+		throw Exception(_ << "block " << pos << ":" << size << " out of " << path() << " (size = " << fsize << ")");
+	src->read(pos, buf, size);
 }
 
 
 /**
- * Read a lock at a particular position.
+ * Get a direct pointer on a block of the file if the source supports it.
  * @param pos	Position in file.
- * @param buf	Buffer to fill in.
- * @param size	Size of the buffer.
+ * @param size	Size of the block.
+ * @return		Pointer on the block or null.
  */
-void File::readAt(t::uint32 pos, void *buf, t::uint32 size) {
-	if(!s->moveTo(pos))
-		throw Exception(_ << "cannot move to position " << pos << " in " << path() << ": " << s->io::InStream::lastErrorMessage());
-	read(buf, size);
+const t::uint8 *File::mapAt(offset_t pos, size_t size) {
+	return src->map(pos, size);
+}
+
+/**
+ * Get a direct pointer on a block of the file that may be modified
+ * (privately) if the source supports it.
+ * @param pos	Position in file.
+ * @param size	Size of the block.
+ * @return		Pointer on the block or null.
+ */
+t::uint8 *File::mapPrivateAt(offset_t pos, size_t size) {
+	return src->mapPrivate(pos, size);
+}
+
+
+/**
+ * Test if the byte order of the file is the same as the host one.
+ * In this case, the content of the file can be used as is without
+ * any byte swapping.
+ * @return	True if the file is in host byte order, false else.
+ */
+bool File::isNative() {
+	return id[EI_DATA] == host_data;
 }
 
 
@@ -231,12 +615,15 @@ Image *File::make(const Parameter& params) {
 
 ///
 void File::initSegments() {
-	if(segs_init)
+	if(segs_init.load(std::memory_order_acquire))
+		return;
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	if(segs_init.load(std::memory_order_relaxed))
 		return;
 	for(auto ph: programHeaders())
 		if(ph->type() == PT_LOAD)
 			segs.add(new Segment(ph));
-	segs_init = true;
+	segs_init.store(true, std::memory_order_release);
 }
 
 
@@ -359,60 +746,183 @@ string File::os() const {
 }
 
 
+/**
+ * @fn void File::setCompactLines(bool compact);
+ * Select the compact mode for the debug line information (see
+ * gel::DebugLine). Must be called before the first call to debugLines().
+ * @param compact	True for compact mode, false else.
+ */
+
+/**
+ * @fn void File::setLazyLines(bool lazy);
+ * Select the lazy mode for the debug line information: the line programs
+ * are decoded on demand (see dwarf::DebugLine). Must be called before the
+ * first call to debugLines().
+ * @param lazy	True for lazy mode, false else.
+ */
+
 ///
 gel::DebugLine *File::debugLines() {
-	if(debug == nullptr)
-		debug = new dwarf::DebugLine(this);
-	return debug;
+	gel::DebugLine *d = debug.load(std::memory_order_acquire);
+	if(d == nullptr) {
+		std::lock_guard<std::recursive_mutex> guard(lock);
+		d = debug.load(std::memory_order_relaxed);
+		if(d == nullptr) {
+			d = new dwarf::DebugLine(this, lazy_lines, compact_lines);
+			debug.store(d, std::memory_order_release);
+		}
+	}
+	return d;
 }
 
 
 ///
 int File::countSections() {
-	initSections();
 	return sectionCount();
 }
 
 
 /**
- * Initialize the section part.
+ * Initialize the section part. Only the section header table is loaded:
+ * the section objects are built on the first access to their index.
  */
 void File::initSections(void) {
-	if(!sects_loaded) {
-		loadSections(sects);
-		sects_loaded = true;
+	if(!sects_loaded.load(std::memory_order_acquire)) {
+		std::lock_guard<std::recursive_mutex> guard(lock);
+		if(!sects_loaded.load(std::memory_order_relaxed)) {
+			int n = loadSectionHeaders();
+			sect_tab = new std::atomic<Section *>[n];
+			for(int i = 0; i < n; i++)
+				sect_tab[i].store(nullptr, std::memory_order_relaxed);
+			sect_cnt = n;
+			sects_loaded.store(true, std::memory_order_release);
+		}
 	}
 }
 
 
 /**
- * Get the sections of the file.
- * @return	File sections.
+ * Get the number of sections, taking into account the extended
+ * section numbering (more than 0xff00 sections).
+ * @return	Number of sections.
  * @throw gel::Exception 	If there is an error when file is read.
  */
-Vector<Section *>& File::sections(void) {
+int File::sectionCount(void) {
 	initSections();
-	return sects;
+	return sect_cnt;
 }
 
 
-///
-gel::Section *File::findSection(cstring name) {
+/**
+ * Get the section at the given index. The section object is built on
+ * the first access: opening a file with a huge number of sections only
+ * costs the access to the used sections.
+ * @param i		Section index (in [0, sectionCount()[).
+ * @return		Section at this index.
+ * @throw gel::Exception 	If there is an error when file is read.
+ */
+Section *File::sectionAt(int i) {
 	initSections();
-	for(auto s: sections())
-		if(s->name() == name)
-			return s;
-	return nullptr;
+	ASSERTP(0 <= i && i < sect_cnt, "section index out of bound");
+	Section *s = sect_tab[i].load(std::memory_order_acquire);
+	if(s == nullptr) {
+		std::lock_guard<std::recursive_mutex> guard(lock);
+		s = sect_tab[i].load(std::memory_order_relaxed);
+		if(s == nullptr) {
+			s = makeSection(i);
+			sect_tab[i].store(s, std::memory_order_release);
+		}
+	}
+	return s;
+}
+
+
+/**
+ * Get the sections of the file. This builds the objects of all sections:
+ * for files with many sections, sectionCount() and sectionAt() are cheaper
+ * when only some sections are used.
+ * @return	File sections.
+ * @throw gel::Exception 	If there is an error when file is read.
+ */
+Vector<Section *>& File::sections(void) {
+	if(!sects_all.load(std::memory_order_acquire)) {
+		std::lock_guard<std::recursive_mutex> guard(lock);
+		if(!sects_all.load(std::memory_order_relaxed)) {
+			int n = sectionCount();
+			sects.setLength(n);
+			for(int i = 0; i < n; i++)
+				sects[i] = sectionAt(i);
+			sects_all.store(true, std::memory_order_release);
+		}
+	}
+	return sects;
 }
 
 
 ///
 Section *File::section(int i) {
-	initSections();
 	return sectionAt(i);
 }
 
 
+/**
+ * Get the extended section indexes (SHT_SYMTAB_SHNDX section) associated
+ * with a symbol table. For a symbol whose st_shndx is SHN_XINDEX, the
+ * actual section index is the 32-bit word at the same index in this buffer.
+ * @param symtab	Symbol table section.
+ * @return			Extended index buffer or a null buffer if there is none.
+ */
+Buffer File::extendedIndexes(Section *symtab) {
+	int n = sectionCount(), si = -1;
+	for(int i = 0; i < n && si < 0; i++)
+		if(sect_tab[i].load(std::memory_order_acquire) == symtab)
+			si = i;
+	for(int i = findSectionOfType(SHT_SYMTAB_SHNDX); i >= 0; i = findSectionOfType(SHT_SYMTAB_SHNDX, i + 1)) {
+		shdr_t h;
+		fetchSection(i, h);
+		if(int(h.link) == si)
+			return sectionAt(i)->content();
+	}
+	return Buffer::null;
+}
+
+
+/**
+ * Find the first section of the given type from the section headers,
+ * without building the section objects.
+ * @param type	Looked section type (one of SHT_xxx).
+ * @param from	Index of the first section to look at.
+ * @return		Index of the found section or -1.
+ * @throw gel::Exception 	If there is an error when file is read.
+ */
+int File::findSectionOfType(t::uint32 type, int from) {
+	int n = sectionCount();
+	for(int i = from; i < n; i++) {
+		shdr_t h;
+		fetchSection(i, h);
+		if(h.type == type)
+			return i;
+	}
+	return -1;
+}
+
+
+/**
+ * Get the name of a section from its header, only building the section
+ * object of the section name table.
+ * @param i		Section index (in [0, sectionCount()[).
+ * @return		Section name.
+ * @throw gel::Exception 	If there is an error when file is read.
+ */
+cstring File::sectionName(int i) {
+	initSections();
+	ASSERTP(0 <= i && i < sect_cnt, "section index out of bound");
+	shdr_t h;
+	fetchSection(i, h);
+	return stringAt(h.name);
+}
+
+
 
 /**
  * @class Section
@@ -425,23 +935,50 @@ Section *File::section(int i) {
  * @param file	Parent file.
  * @param entry	Section entry.
  */
-Section::Section(elf::File *file): _file(file), buf(0) {
+Section::Section(elf::File *file): _file(file), buf(0), own(true) {
 }
 
 Section::~Section(void) {
-	if(buf)
-		delete [] buf;
+	t::uint8 *b = buf.load();
+	if(b && own)
+		delete [] b;
 }
 
 /**
- * Get the content of the section (if any).
+ * Get the content of the section (if any). When the file source supports it,
+ * the returned buffer points directly in the privately mapped file: a write
+ * in the buffer only copies the modified page and never changes the file.
  * @return	Section content.
  * @throw gel::Exception	If there is a file read error.
  */
 Buffer Section::content() {
-	if(!buf)
-		buf = readBuf();
-	return Buffer(_file, buf, size());
+	t::uint8 *b = buf.load(std::memory_order_acquire);
+	if(!b) {
+		std::lock_guard<std::recursive_mutex> guard(_file->lock);
+		b = buf.load(std::memory_order_relaxed);
+		if(!b) {
+			own = true;
+			b = readBuf();
+			buf.store(b, std::memory_order_release);
+		}
+	}
+	return Buffer(_file, b, size());
+}
+
+
+/**
+ * Get a direct pointer on a block of the file that may be modified without
+ * changing the file. If it succeeds, the returned block is not owned by the
+ * section.
+ * @param pos	Position in the file.
+ * @param size	Size of the block.
+ * @return		Pointer on the block or null if the file cannot be mapped.
+ */
+t::uint8 *Section::map(offset_t pos, size_t size) {
+	auto p = _file->mapPrivateAt(pos, size);
+	if(p != nullptr)
+		own = false;
+	return p;
 }
 
 
@@ -461,25 +998,74 @@ Buffer Section::buffer() {
 
 /**
  */
-ProgramHeader::ProgramHeader(elf::File *file): _file(file), _buf(nullptr) {
+ProgramHeader::ProgramHeader(elf::File *file): _file(file), _buf(nullptr), _own(true) {
 }
 
 /**
  */
 ProgramHeader::~ProgramHeader(void) {
-	if(_buf)
-		delete [] _buf;
+	t::uint8 *b = _buf.load();
+	if(b && _own)
+		delete [] b;
 }
 
 /**
- * Get the content of the program header.
+ * Get the content of the program header. When the file source supports it
+ * and the program header has no zero-filled part, the returned buffer points
+ * directly in the privately mapped file: a write in the buffer only copies
+ * the modified page and never changes the file.
  * @return	Program header contant.
  * @throw gel::Exception	If there is an error at file read.
  */
 Buffer ProgramHeader::content(void) {
-	if(_buf == nullptr)
-		_buf = readBuf();
-	return Buffer(_file, _buf, memsz());
+	t::uint8 *b = _buf.load(std::memory_order_acquire);
+	if(b == nullptr) {
+		std::lock_guard<std::recursive_mutex> guard(_file->lock);
+		b = _buf.load(std::memory_order_relaxed);
+		if(b == nullptr) {
+			_own = true;
+			b = readBuf();
+			_buf.store(b, std::memory_order_release);
+		}
+	}
+	return Buffer(_file, b, memsz());
+}
+
+/**
+ * Get the part of the program header content coming from the file, that is,
+ * without the zero-filled tail. If the content has not been loaded yet and
+ * the file source supports it, the returned buffer points directly in the
+ * mapped file and the zero-filled part is never allocated: in this case,
+ * the buffer is read-only and must not be modified.
+ * @return	Program header file content.
+ * @throw gel::Exception	If there is an error at file read.
+ */
+Buffer ProgramHeader::fileContent(void) {
+	t::uint8 *b = _buf.load(std::memory_order_acquire);
+	if(b == nullptr) {
+		if(filesz() == 0)
+			return Buffer(_file, b, 0);
+		auto p = _file->mapAt(offset(), filesz());
+		if(p != nullptr)
+			return Buffer(_file, p, filesz());
+		b = content().bytes();
+	}
+	return Buffer(_file, b, min(filesz(), memsz()));
+}
+
+/**
+ * Get a direct pointer on a block of the file that may be modified without
+ * changing the file. If it succeeds, the returned block is not owned by the
+ * program header.
+ * @param pos	Position in the file.
+ * @param size	Size of the block.
+ * @return		Pointer on the block or null if the file cannot be mapped.
+ */
+t::uint8 *ProgramHeader::map(offset_t pos, size_t size) {
+	auto p = _file->mapPrivateAt(pos, size);
+	if(p != nullptr)
+		_own = false;
+	return p;
 }
 
 /**
@@ -511,29 +1097,215 @@ cstring Symbol::name() {
 	return _name;
 }
 
+///
+Symbol::type_t Symbol::type() {
+	switch(elfType()) {
+	case STT_OBJECT:	return DATA;
+	case STT_FUNC:		return FUNC;
+	default:			return OTHER_TYPE;
+	}
+}
+
+///
+Symbol::bind_t Symbol::bind() {
+	switch(elfBind()) {
+	case STB_LOCAL:		return LOCAL;
+	case STB_GLOBAL:	return GLOBAL;
+	case STB_WEAK:		return WEAK;
+	default:			return OTHER_BIND;
+	}
+}
+
 
 /**
  * @class SymbolTable
  * A table of symbols of an ELF file.
+ *
+ * The symbols are stored as a structure of arrays allocated in one arena
+ * for the whole file: the table is first sized with reserve() and the entries
+ * are then appended with add(). All entries are kept in the order of the
+ * symbol tables, including the ones sharing the same name (local helpers,
+ * labels, etc): they can be scanned with length() and entry() or retrieved
+ * by name with all(). The gel::Symbol interface is provided by lightweight
+ * views stored in the arena too.
+ *
+ * As a map, the table associates each name with the preferred
+ * symbol of this name: global symbols are preferred to weak symbols that are
+ * preferred to local symbols. Among symbols of the same binding, the first
+ * one in table order is kept.
  * @ingroup elf
  */
 
+// view on an entry of the symbol table
+class SymbolTable::View: public Symbol {
+public:
+	inline View(cstring name, const SymbolTable *table, int index)
+		: Symbol(name), _table(table), _index(index) { }
+
+	t::uint8 elfBind()	override { return ELF32_ST_BIND(_table->_info[_index]); }
+	t::uint8 elfType()	override { return ELF32_ST_TYPE(_table->_info[_index]); }
+	int shndx()			override { return _table->_shndx[_index]; }
+	t::uint64 value()	override { return _table->_values[_index]; }
+	t::uint64 size()	override { return _table->_sizes[_index]; }
+
+private:
+	const SymbolTable *_table;
+	int _index;
+};
+
+// rank of a binding when several symbols have the same name
+static int bindRank(t::uint8 bind) {
+	switch(bind) {
+	case STB_GLOBAL:	return 3;
+	case STB_WEAK:		return 2;
+	case STB_LOCAL:		return 1;
+	default:			return 0;
+	}
+}
+
 
 /**
- * Build the symbol table.
+ * Build an empty symbol table.
  */
+SymbolTable::SymbolTable():
+	_arena(nullptr),
+	_views(nullptr),
+	_values(nullptr),
+	_sizes(nullptr),
+	_shndx(nullptr),
+	_info(nullptr),
+	_other(nullptr),
+	_cnt(0),
+	_cap(0),
+	_byname(nullptr)
+{ }
 
 
 ///
 SymbolTable::~SymbolTable() {
-	for(auto m: mems)
-		delete [] m;
+	for(int i = 0; i < _cnt; i++)
+		_views[i].~View();
+	delete [] _arena;
+	delete [] _byname.load();
 }
 
 
-///
-void SymbolTable::record(elm::t::uint8 *mem) {
-	mems.add(mem);
+/**
+ * Allocate the arena for the given number of symbols. Must be called once
+ * before adding symbols.
+ * @param n		Total number of symbols.
+ */
+void SymbolTable::reserve(int n) {
+	ASSERT(_arena == nullptr);
+	std::size_t s = std::size_t(n) * (sizeof(View) + 2 * sizeof(t::uint64) + sizeof(t::uint32) + 2);
+	_arena = new t::uint8[s];
+	t::uint8 *p = _arena;
+	_views = reinterpret_cast<View *>(p);
+	p += n * sizeof(View);
+	_values = reinterpret_cast<t::uint64 *>(p);
+	p += n * sizeof(t::uint64);
+	_sizes = reinterpret_cast<t::uint64 *>(p);
+	p += n * sizeof(t::uint64);
+	_shndx = reinterpret_cast<t::uint32 *>(p);
+	p += n * sizeof(t::uint32);
+	_info = p;
+	p += n;
+	_other = p;
+	_cap = n;
+}
+
+
+/**
+ * Add a symbol at the end of the table.
+ * @param name		Symbol name.
+ * @param value		Symbol value.
+ * @param size		Symbol size.
+ * @param info		ELF information (binding and type).
+ * @param other		ELF other field (visibility).
+ * @param shndx		Index of the section containing the symbol (extended index if any).
+ * @return			Added symbol.
+ */
+Symbol *SymbolTable::add(cstring name, t::uint64 value, t::uint64 size, t::uint8 info, t::uint8 other, t::uint32 shndx) {
+	ASSERT(_cnt < _cap);
+	int i = _cnt++;
+	_values[i] = value;
+	_sizes[i] = size;
+	_shndx[i] = shndx;
+	_info[i] = info;
+	_other[i] = other;
+	View *v = new(_views + i) View(name, this, i);
+
+	// record it in the map
+	Symbol *old = static_cast<Symbol *>(get(name, nullptr));
+	if(old == nullptr || bindRank(v->elfBind()) > bindRank(old->elfBind()))
+		put(name, v);
+	return v;
+}
+
+
+/**
+ * @fn int SymbolTable::length() const;
+ * Get the number of symbols in the table (including symbols with the same name).
+ * @return	Number of symbols.
+ */
+
+
+/**
+ * Get a symbol by its index in the table (symbols are in the order
+ * of the ELF symbol tables).
+ * @param i		Symbol index.
+ * @return		Symbol at this index.
+ */
+Symbol& SymbolTable::entry(int i) const {
+	ASSERT(0 <= i && i < _cnt);
+	return _views[i];
+}
+
+
+/**
+ * Get all symbols with the given name, in table order. The first call
+ * builds an index of the symbols sorted by name.
+ * @param name	Looked name.
+ * @return		Symbols with this name (possibly empty).
+ */
+Vector<Symbol *> SymbolTable::all(cstring name) const {
+
+	// build the index if needed
+	int *byname = _byname.load(std::memory_order_acquire);
+	if(byname == nullptr) {
+		std::lock_guard<std::mutex> guard(_mutex);
+		byname = _byname.load(std::memory_order_relaxed);
+		if(byname == nullptr) {
+			byname = new int[_cnt];
+			for(int i = 0; i < _cnt; i++)
+				byname[i] = i;
+			std::stable_sort(byname, byname + _cnt, [this](int i, int j)
+				{ return _views[i].name() < _views[j].name(); });
+			_byname.store(byname, std::memory_order_release);
+		}
+	}
+
+	// look for the range
+	auto r = std::equal_range(byname, byname + _cnt, -1, [this, name](int i, int j) {
+		cstring n1 = i < 0 ? name : _views[i].name();
+		cstring n2 = j < 0 ? name : _views[j].name();
+		return n1 < n2;
+	});
+	Vector<Symbol *> res;
+	for(auto p = r.first; p != r.second; p++)
+		res.add(_views + *p);
+	return res;
+}
+
+
+/**
+ * Collect all the symbols of the table, including the ones hidden in the map
+ * by a symbol of the same name, so that at() and nearest() also find them.
+ * @param syms	Vector to add symbols to.
+ */
+void SymbolTable::collect(Vector<gel::Symbol *>& syms) const {
+	for(int i = 0; i < _cnt; i++)
+		syms.add(_views + i);
 }
 
 
@@ -627,11 +1399,9 @@ File::DynIter::DynIter(File& file, Section *sec, bool ended): EntryIter(file, se
 }
 
 Range<File::DynIter> File::dyns() {
-	for(auto s: sects)
-		if(s->type() == SHT_DYNAMIC)
-			return dyns(s);
-	ASSERT(false);
-	return dyns(nullptr);
+	int i = findSectionOfType(SHT_DYNAMIC);
+	ASSERT(i >= 0);
+	return dyns(i < 0 ? nullptr : sectionAt(i));
 }
 
 Range<File::DynIter> File::dyns(Section *sect) {
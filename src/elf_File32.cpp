@@ -17,9 +17,11 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <limits>
 #include <elm/array.h>
 #include <gel++/elf/defs.h>
 #include <gel++/elf/File32.h>
+#include <gel++/elf/Reader.h>
 #include <gel++/elf/UnixBuilder.h>
 #include <gel++/Image.h>
 
@@ -39,9 +41,24 @@ namespace gel { namespace elf {
  * @param stream	Stream to read from.
  */
 File32::File32(Manager& manager, sys::Path path, io::RandomAccessStream *stream)
-:	elf::File(manager, path, stream),
+:	File32(manager, path, new StreamSource(path, stream))
+{
+}
+
+/**
+ * Constructor from a generic source.
+ * @param manager	Parent manager.
+ * @param path		File path.
+ * @param source	Source to read from (ownership is transferred to the file).
+ */
+File32::File32(Manager& manager, sys::Path path, Source *source)
+:	elf::File(manager, path, source),
 	h(new Elf32_Ehdr),
+	shnum(0),
+	shstrndx(0),
+	phnum(0),
 	sec_buf(nullptr),
+	sec_own(false),
 	ph_buf(nullptr)
 {
 	setIdent(h->e_ident);
@@ -52,26 +69,42 @@ File32::File32(Manager& manager, sys::Path path, io::RandomAccessStream *stream)
 	|| h->e_ident[3] != ELFMAG3)
 		throw Exception("not an ELF file");
 	ASSERT(h->e_ident[EI_CLASS] == ELFCLASS32);
-	fix(h->e_type);
-	fix(h->e_machine);
-	fix(h->e_version);
-	fix(h->e_entry);
-	fix(h->e_shnum);
-	fix(h->e_phnum);
-	fix(h->e_shentsize);
-	fix(h->e_phentsize);
-	fix(h->e_shstrndx);
-	if(h->e_shstrndx >= h->e_shnum)
+	codec = Codec<ELFCLASS32>(h->e_ident[EI_DATA]);
+	setMode(codec.isNative() ? NATIVE : SWAP);
+	codec.fix(*h);
+
+	// get the numbers, possibly extended in section 0
+	shnum = h->e_shnum;
+	shstrndx = h->e_shstrndx;
+	phnum = h->e_phnum;
+	if(h->e_shoff == 0)
+		shnum = 0;
+	else {
+		if(h->e_shentsize < sizeof(Elf32_Shdr))
+			throw Exception("malformed ELF");
+		if(shnum == 0 || shstrndx == SHN_XINDEX || phnum == PN_XNUM) {
+			Elf32_Shdr s0;
+			readAt(h->e_shoff, &s0, sizeof(s0));
+			codec.fix(s0);
+			if(shnum == 0)
+				shnum = s0.sh_size;
+			if(shstrndx == SHN_XINDEX)
+				shstrndx = s0.sh_link;
+			if(phnum == PN_XNUM)
+				phnum = s0.sh_info;
+		}
+	}
+	if(shnum > t::uint32(std::numeric_limits<int>::max())
+	|| (shnum != 0 && shstrndx >= shnum)
+	|| (phnum != 0 && h->e_phentsize < sizeof(Elf32_Phdr)))
 		throw Exception("malformed ELF");
-	fix(h->e_shoff);
-	fix(h->e_phoff);
 }
 
 /**
  */
 File32::~File32(void) {
 	delete h;
-	if(sec_buf)
+	if(sec_own)
 		delete [] sec_buf;
 	if(ph_buf)
 		delete [] ph_buf;
@@ -83,23 +116,26 @@ void File32::loadProgramHeaders(Vector<ProgramHeader *>& headers) {
 	if(ph_buf == nullptr) {
 
 		// load it
-		ph_buf = new t::uint8[h->e_phentsize * h->e_phnum];
-		readAt(h->e_phoff, ph_buf, h->e_phentsize * h->e_phnum);
+		ph_buf = new t::uint8[size_t(h->e_phentsize) * phnum];
+		readAt(h->e_phoff, ph_buf, size_t(h->e_phentsize) * phnum);
 
 		// build them
-		headers.setLength(h->e_phnum);
-		for(int i = 0; i < h->e_phnum; i++) {
-			Elf32_Phdr *ph = (Elf32_Phdr *)(ph_buf + i * h->e_phentsize);
-			fix(ph->p_align);
-			fix(ph->p_filesz);
-			fix(ph->p_flags);
-			fix(ph->p_memsz);
-			fix(ph->p_offset);
-			fix(ph->p_paddr);
-			fix(ph->p_type);
-			fix(ph->p_vaddr);
-			headers[i] = new ProgramHeader32(this, ph);
-		}
+		codec.fixTable<Elf32_Phdr>(ph_buf, phnum, h->e_phentsize);
+		headers.setLength(phnum);
+		for(int i = 0; i < int(phnum); i++)
+			headers[i] = new ProgramHeader32(this, (Elf32_Phdr *)(ph_buf + i * h->e_phentsize));
+	}
+}
+
+
+///
+void File32::prefetchHeaders() {
+	if(phnum != 0)
+		source()->prefetch(h->e_phoff, size_t(h->e_phentsize) * phnum);
+	if(shnum != 0) {
+		offset_t top = h->e_shoff + size_t(h->e_shentsize) * shnum;
+		offset_t base = h->e_shoff > shstrtab_guess ? h->e_shoff - shstrtab_guess : 0;
+		source()->prefetch(base, top - base);
 	}
 }
 
@@ -163,107 +199,92 @@ address_t File32::entry(void) {
 
 
 ///
-void File32::loadSections(Vector<Section *>& sections) {
-
-	// allocate memory
-	t::uint32 size = h->e_shentsize * h->e_shnum;
-	sec_buf = new t::uint8[size];
-	array::set<uint8_t>(sec_buf, size, 0);
+int File32::loadSectionHeaders() {
+	if(shnum == 0)
+		return 0;
+
+	// map the table if it does not need to be decoded, or load it
+	size_t size = size_t(h->e_shentsize) * shnum;
+	if(codec.isNative())
+		sec_buf = const_cast<t::uint8 *>(mapAt(h->e_shoff, size));
+	if(sec_buf == nullptr) {
+		sec_buf = new t::uint8[size];
+		sec_own = true;
+		readAt(h->e_shoff, sec_buf, size);
+	}
+	return shnum;
+}
 
-	// load sections
-	readAt(h->e_shoff, sec_buf, size);
+///
+Section *File32::makeSection(int i) {
+	Elf32_Shdr s;
+	array::copy(reinterpret_cast<t::uint8 *>(&s), sec_buf + size_t(i) * h->e_shentsize, sizeof(s));
+	codec.fix(s);
+	return new Section32(this, s);
+}
 
-	// initialize sections
-	sections.setLength(h->e_shnum);
-	for(int i = 0; i < h->e_shnum; i++) {
-		Elf32_Shdr *s = (Elf32_Shdr *)(sec_buf + i * h->e_shentsize);
-		fix(s->sh_addr);
-		fix(s->sh_addralign);
-		fix(s->sh_entsize);
-		fix(s->sh_flags);
-		fix(s->sh_info);
-		fix(s->sh_link);
-		fix(s->sh_name);
-		fix(s->sh_offset);
-		fix(s->sh_size);
-		fix(s->sh_type);
-		sections[i] = new Section32(this, s);
-	}
+///
+void File32::fetchSection(int i, shdr_t& sect) {
+	Elf32_Shdr s;
+	array::copy(reinterpret_cast<t::uint8 *>(&s), sec_buf + size_t(i) * h->e_shentsize, sizeof(s));
+	codec.fix(s);
+	sect.name = s.sh_name;
+	sect.type = s.sh_type;
+	sect.link = s.sh_link;
 }
 
 ///
 int File32::getStrTab() {
-	return h->e_shstrndx;
+	return shstrndx;
 }
 
 ///
 void File32::fetchDyn(const t::uint8 *entry, dyn_t& dyn) {
-	auto e = *reinterpret_cast<const Elf32_Dyn *>(entry);
-	fix(e.d_tag);
-	fix(e.d_un.d_val);
-	dyn.tag = e.d_tag;
-	dyn.un.val = e.d_un.d_val;
+	t::int64 tag;
+	codec.readDyn(entry, tag, dyn.un.val);
+	dyn.tag = tag;
 }
 
-
 ///
-class Symbol32: public Symbol {
-public:
-	inline Symbol32(cstring name, Elf32_Sym *info): Symbol(name), _info(info) { }
-
-	t::uint8 elfBind()	override { return ELF32_ST_BIND(_info->st_info); }
-	t::uint8 elfType()	override { return ELF32_ST_TYPE(_info->st_info); }
-	int shndx()			override { return _info->st_shndx; }
-
-	t::uint64 value()	override { return _info->st_value; }
-	t::uint64 size()	override { return _info->st_size; }
-
-	type_t type() override {
-		switch(ELF32_ST_TYPE(_info->st_info)) {
-		case STT_OBJECT:	return DATA;
-		case STT_FUNC:		return FUNC;
-		default:			return OTHER_TYPE;
-		}
-	}
-
-	bind_t bind() override {
-		switch(ELF32_ST_BIND(_info->st_info)) {
-		case STB_LOCAL:		return LOCAL;
-		case STB_GLOBAL:	return GLOBAL;
-		case STB_WEAK:		return WEAK;
-		default:			return OTHER_BIND;
-		}
-	}
-
-private:
-	Elf32_Sym *_info;
-};
+void File32::fetchSym(const t::uint8 *entry, sym_t& sym) {
+	Elf32_Sym s;
+	array::copy(reinterpret_cast<t::uint8 *>(&s), entry, sizeof(s));
+	codec.fix(s);
+	sym.name = s.st_name;
+	sym.value = s.st_value;
+	sym.size = s.st_size;
+	sym.info = s.st_info;
+	sym.other = s.st_other;
+	sym.shndx = s.st_shndx;
+}
 
 
 ///
 void File32::fillSymbolTable(SymbolTable& symtab, Section *sect) {
 
-	// get the data
+	// get the data (read and decoded once, shared with the section)
 	auto size = sect->size();
-	t::uint8 *buf = new t::uint8[size];
-	sect->read(buf);
-	symtab.record(buf);
-	int str = sect->link();
-
-	// read the symbols
 	auto entsize = sect->entsize();
-	if((size / entsize) * entsize != size)
+	if(entsize < sizeof(Elf32_Sym) || (size / entsize) * entsize != size)
 		throw Exception(_ << "garbage found at end of symbol table " << sect->name());
-	Cursor c(Buffer(this, buf, size));
-	while(c.avail(entsize)) {
-		Elf32_Sym *s = (Elf32_Sym *)c.here();
-		c.decoder()->fix(s->st_name);
-		c.decoder()->fix(s->st_value);
-		c.decoder()->fix(s->st_size);
-		c.decoder()->fix(s->st_shndx);
-		c.skip(entsize);
-		auto name = stringAt(s->st_name, str);
-		symtab.put(name, new Symbol32(name, s));
+	if(sect->link() >= t::uint32(sectionCount()))
+		throw Exception(_ << "bad string table index in " << sect->name());
+	const t::uint8 *buf = sect->content().bytes();
+	Buffer strs = sectionAt(sect->link())->content();
+
+	Buffer xind = extendedIndexes(sect);
+
+	// read the symbols
+	for(size_t off = 0, k = 0; off < size; off += entsize, k++) {
+		const Elf32_Sym *s = reinterpret_cast<const Elf32_Sym *>(buf + off);
+		cstring name;
+		if(s->st_name >= strs.size())
+			throw Exception(_ << "bad symbol name offset in " << sect->name());
+		strs.get(s->st_name, name);
+		t::uint32 shndx = s->st_shndx;
+		if(shndx == SHN_XINDEX && (k + 1) * sizeof(t::uint32) <= xind.size())
+			xind.get(k * sizeof(t::uint32), shndx);
+		symtab.add(name, s->st_value, s->st_size, s->st_info, s->st_other, shndx);
 	}
 }
 
@@ -277,32 +298,32 @@ void File32::fillSymbolTable(SymbolTable& symtab, Section *sect) {
 /**
  * Builder.
  * @param file	Parent file.
- * @param entry	Section entry.
+ * @param entry	Section entry (decoded).
  */
-Section32::Section32(elf::File32 *file, Elf32_Shdr *entry): elf::Section(file), _info(entry) {
+Section32::Section32(elf::File32 *file, const Elf32_Shdr& entry): elf::Section(file), _info(entry) {
 }
 
 
 ///
 t::uint8 *Section32::readBuf() {
 
+	// symbol tables need to be fixed if the file is not native
+	bool sym = _info.sh_type == SHT_SYMTAB || _info.sh_type == SHT_DYNSYM;
+	if(!sym || file()->isNative()) {
+		t::uint8 *buf = map(_info.sh_offset, _info.sh_size);
+		if(buf != nullptr)
+			return buf;
+	}
+
 	// read the data
-	t::uint8 *buf = new t::uint8[_info->sh_size];
-	readAt(_info->sh_offset, buf, _info->sh_size);
+	t::uint8 *buf = new t::uint8[_info.sh_size];
+	readAt(_info.sh_offset, buf, _info.sh_size);
 
 	// fix endianness according to the section type
-	if(_info->sh_type == SHT_SYMTAB || _info->sh_type == SHT_DYNSYM) {
-		if((_info->sh_size / _info->sh_entsize) * _info->sh_entsize != _info->sh_size)
+	if(sym) {
+		if(_info.sh_entsize < sizeof(Elf32_Sym) || (_info.sh_size / _info.sh_entsize) * _info.sh_entsize != _info.sh_size)
 			throw Exception(_ << "garbage found at end of symbol table " << name());
-		Cursor c(Buffer(file(), buf, _info->sh_size));
-		while(c.avail(_info->sh_entsize)) {
-			Elf32_Sym *s = (Elf32_Sym *)c.here();
-			c.decoder()->fix(s->st_name);
-			c.decoder()->fix(s->st_value);
-			c.decoder()->fix(s->st_size);
-			c.decoder()->fix(s->st_shndx);
-			c.skip(_info->sh_entsize);
-		}
+		static_cast<File32 *>(file())->codec.fixTable<Elf32_Sym>(buf, _info.sh_size / _info.sh_entsize, _info.sh_entsize);
 	}
 
 	return buf;
@@ -311,12 +332,12 @@ t::uint8 *Section32::readBuf() {
 
 ///
 void Section32::read(t::uint8 *buf) {
-	readAt(_info->sh_offset, buf, _info->sh_size);
+	readAt(_info.sh_offset, buf, _info.sh_size);
 }
 
 ///
 address_t Section32::baseAddress() {
-	return _info->sh_addr;
+	return _info.sh_addr;
 }
 
 ///
@@ -326,27 +347,27 @@ address_t Section32::loadAddress() {
 
 ///
 size_t Section32::alignment() {
-	return _info->sh_addralign;
+	return _info.sh_addralign;
 }
 
 ///
 bool Section32::isExecutable() {
-	return (_info->sh_flags & SHF_EXECINSTR) != 0;
+	return (_info.sh_flags & SHF_EXECINSTR) != 0;
 }
 
 ///
 bool Section32::isWritable() {
-	return (_info->sh_flags & SHF_WRITE) != 0;
+	return (_info.sh_flags & SHF_WRITE) != 0;
 }
 
 ///
 bool Section32::hasContent() {
-	return _info->sh_size != 0;
+	return _info.sh_size != 0;
 }
 
 ///
 size_t Section32::fileSize() {
-	return _info->sh_size;
+	return _info.sh_size;
 }
 
 
@@ -358,42 +379,42 @@ size_t Section32::fileSize() {
 
 ///
 t::uint32 Section32::flags() {
-	return _info->sh_flags;
+	return _info.sh_flags;
 }
 
 ///
 int Section32::type() const {
-	return _info->sh_type;
+	return _info.sh_type;
 }
 
 ///
 t::uint32 Section32::link() const {
-	return _info->sh_link;
+	return _info.sh_link;
 }
 
 ///
 t::uint64 Section32::offset() {
-	return _info->sh_offset;
+	return _info.sh_offset;
 }
 
 ///
 address_t Section32::addr() const {
-	return _info->sh_addr;
+	return _info.sh_addr;
 }
 
 ///
 size_t Section32::size() {
-	return _info->sh_size;
+	return _info.sh_size;
 }
 
 ///
 size_t Section32::entsize() const {
-	return _info->sh_entsize;
+	return _info.sh_entsize;
 }
 
 ///
 cstring Section32::name() {
-	return file()->stringAt(_info->sh_name);
+	return file()->stringAt(_info.sh_name);
 }
 
 
@@ -429,11 +450,16 @@ offset_t 	ProgramHeader32::offset() const { return _info->p_offset; }
 
 ///
 t::uint8 *ProgramHeader32::readBuf() {
+	if(_info->p_filesz == _info->p_memsz) {
+		t::uint8 *buf = map(_info->p_offset, _info->p_filesz);
+		if(buf != nullptr)
+			return buf;
+	}
 	t::uint8 *_buf = new t::uint8[_info->p_memsz];
 	if(_info->p_filesz)
 		readAt(_info->p_offset, _buf, _info->p_filesz);
 	if(_info->p_filesz < _info->p_memsz)
-		array::set(_buf, _info->p_memsz - _info->p_filesz, t::uint8(0));
+		array::set(_buf + _info->p_filesz, _info->p_memsz - _info->p_filesz, t::uint8(0));
 	return _buf;
 }
 
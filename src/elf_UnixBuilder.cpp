@@ -126,7 +126,7 @@ t::uint32 Unit::load(UnixBuilder& builder, t::uint32 base) {
 					f |= ImageSegment::READABLE;
 				if(h->filesz() != 0)
 					f |= ImageSegment::CONTENT;
-				ImageSegment *is = new ImageSegment(_file, h->content(), base + h->vaddr(), f);
+				ImageSegment *is = new ImageSegment(_file, h->fileContent(), base + h->vaddr(), h->memsz(), f);
 				builder._im->add(is);
 				top = max(top, _base + h->vaddr() + h->memsz());
 			}
@@ -168,25 +168,27 @@ void Unit::link(UnixBuilder& builder) {
 
 	// first collect static information
 	// TODO should be improved to use only loaded segments
-	for(Cursor c(_dyn->content()); c.avail(sizeof(Elf32_Dyn)); c.skip(sizeof(Elf32_Dyn))) {
-		Elf32_Dyn *e = (Elf32_Dyn *)c.here();
-		Elf32_Sword tag = e->d_tag;
-		c.decoder()->fix(tag);
-		switch(e->d_tag) {
+	// (entries are decoded in locals as the content may be a read-only mapping)
+	for(Cursor c(_dyn->content()); c.avail(sizeof(Elf32_Dyn));) {
+		t::int32 tag;
+		t::uint32 val;
+		c.read(tag);
+		c.read(val);
+		switch(tag) {
 		case DT_NULL:		c.finish(); break;
 		case DT_NEEDED:		break;
-		case DT_PLTRELSZ:	c.decoder()->fix(e->d_un.d_val); pltrelsz = e->d_un.d_val; break;
-		case DT_PLTGOT:		c.decoder()->fix(e->d_un.d_ptr); pltgot = e->d_un.d_ptr; break;
-		case DT_HASH:		c.decoder()->fix(e->d_un.d_ptr); hash = e->d_un.d_ptr; break;
-		case DT_STRTAB:		c.decoder()->fix(e->d_un.d_ptr); strtab = e->d_un.d_ptr; break;
-		case DT_SYMTAB:		c.decoder()->fix(e->d_un.d_ptr); symtab = e->d_un.d_ptr; break;
+		case DT_PLTRELSZ:	pltrelsz = val; break;
+		case DT_PLTGOT:		pltgot = val; break;
+		case DT_HASH:		hash = val; break;
+		case DT_STRTAB:		strtab = val; break;
+		case DT_SYMTAB:		symtab = val; break;
 		case DT_RELA:		break;
 		case DT_RELASZ:		break;
 		case DT_RELAENT:	break;
-		case DT_STRSZ:		c.decoder()->fix(e->d_un.d_val); strsz = e->d_un.d_val; break;
-		case DT_SYMENT:		c.decoder()->fix(e->d_un.d_val); syment = e->d_un.d_val; break;
-		case DT_INIT:		c.decoder()->fix(e->d_un.d_ptr); init = e->d_un.d_ptr; break;
-		case DT_FINI:		c.decoder()->fix(e->d_un.d_ptr); fini = e->d_un.d_ptr; break;
+		case DT_STRSZ:		strsz = val; break;
+		case DT_SYMENT:		syment = val; break;
+		case DT_INIT:		init = val; break;
+		case DT_FINI:		fini = val; break;
 		case DT_SONAME:		/* TODO */; break;
 		case DT_RPATH:		break;
 		case DT_SYMBOLIC:	flags |= SYMBOLIC; break;
@@ -194,12 +196,12 @@ void Unit::link(UnixBuilder& builder) {
 		case DT_RELSZ:		break;
 		case DT_RELENT:		break;
 		case DT_PLTREL:		break;
-		case DT_DEBUG:		c.decoder()->fix(e->d_un.d_ptr); debug = e->d_un.d_ptr; break;
+		case DT_DEBUG:		debug = val; break;
 		case DT_TEXTREL:	flags |= TEXTREL; break;
 		case DT_JMPREL:		break;
 		case DT_BIND_NOW:	flags |= BIND_NOW; break;
 		default:
-			builder.onError(level_warning, _ << "unknown dynamic entry: " << io::hex(e->d_tag));
+			builder.onError(level_warning, _ << "unknown dynamic entry: " << io::hex(tag));
 			break;
 		}
 	}
@@ -210,19 +212,18 @@ void Unit::link(UnixBuilder& builder) {
 		throw Exception("STRTAB address not in loaded segments!");
 
 	// perform the link itself
-	for(Cursor c(_dyn->content()); c.avail(sizeof(Elf32_Dyn)); c.skip(sizeof(Elf32_Dyn))) {
-		Elf32_Dyn *e = (Elf32_Dyn *)c.here();
-		Elf32_Sword tag = e->d_tag;
-		c.decoder()->fix(tag);
-		switch(e->d_tag) {
+	for(Cursor c(_dyn->content()); c.avail(sizeof(Elf32_Dyn));) {
+		t::int32 tag;
+		t::uint32 off;
+		c.read(tag);
+		c.read(off);
+		switch(tag) {
 
 		case DT_NULL:
 			c.finish();
 			break;
 
 		case DT_RPATH: {
-				t::uint32 off = e->d_un.d_val;
-				c.decoder()->fix(off);
 				string path = getString(str, off);
 				int i = path.indexOf(':');
 				while(i >= 0) {
@@ -235,8 +236,6 @@ void Unit::link(UnixBuilder& builder) {
 			break;
 
 		case DT_NEEDED: {
-				t::uint32 off = e->d_un.d_val;
-				c.decoder()->fix(off);
 				cstring name = getString(str, off);
 				Unit *u = builder.resolve(name, this);
 				_needed.add(u);
@@ -258,7 +257,8 @@ cstring Unit::getString(ImageSegment *s, t::uint32 off) {
 	if(off >= strsz)
 		throw gel::Exception("bad offset in DT_RPATH entry");
 	cstring name;
-	s->buffer().get(off - s->base(), name);
+	Buffer buf = static_cast<const ImageSegment *>(s)->buffer();
+	buf.get(off - s->base(), name);
 	return name;
 }
 
@@ -515,16 +515,15 @@ ImageSegment *UnixBuilder::buildStack(void) {
 	if(_params.sp)
 		*_params.sp = sp;
 
-	// create the segment
-	Buffer buf(_prog, new t::uint8[size], size);
-	ImageSegment *seg = new ImageSegment(buf, addr, ImageSegment::WRITABLE | ImageSegment::TO_FREE, "stack");
+	// create the segment (zero-filled pages are only allocated when written)
+	ImageSegment *seg = new ImageSegment(_prog, addr, size, ImageSegment::WRITABLE | ImageSegment::STACK, "stack");
 	if(_params.sp_segment)
 		*_params.sp_segment = seg;
 	_im->add(seg);
 
 	// put the main arguments
+	Buffer buf(_prog, new t::uint8[isize](), isize);
 	Cursor c(buf);
-	c.skip(size - isize);
 	c.write(t::uint32(_params.arg.count()));
 	c.write(t::uint32(sp + arg_a));
 	c.write(t::uint32(sp + env_a));
@@ -560,6 +559,9 @@ ImageSegment *UnixBuilder::buildStack(void) {
 	for(int i = 0; i < _params.env.count(); i++)
 		c.write(_params.env[i]);
 
+	// copy the initial block at the top of the stack
+	seg->write(size - isize, buf.bytes(), isize);
+	delete [] buf.bytes();
 	return seg;
 }
 
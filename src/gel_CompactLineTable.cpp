@@ -0,0 +1,410 @@
+/*
+ * GEL++ CompactLineTable class implementation
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <elm/assert.h>
+#include <elm/compare.h>
+#include <elm/data/HashMap.h>
+#include <gel++/CompactLineTable.h>
+
+namespace gel {
+
+// bits of the row header byte
+static const t::uint8
+	flag_mask		= 0x1f,
+	file_changed	= 0x20,
+	col_changed		= 0x40,
+	has_extra		= 0x80;
+
+static inline void writeU(Vector<t::uint8>& out, t::uint64 v) {
+	do {
+		t::uint8 b = v & 0x7f;
+		v >>= 7;
+		if(v != 0)
+			b |= 0x80;
+		out.add(b);
+	} while(v != 0);
+}
+
+static inline void writeS(Vector<t::uint8>& out, t::int64 v) {
+	writeU(out, (t::uint64(v) << 1) ^ t::uint64(v >> 63));
+}
+
+static inline t::uint64 readU(const t::uint8 *& p) {
+	t::uint64 v = 0;
+	int s = 0;
+	t::uint8 b;
+	do {
+		b = *p++;
+		v |= t::uint64(b & 0x7f) << s;
+		s += 7;
+	} while(b & 0x80);
+	return v;
+}
+
+static inline t::int64 readS(const t::uint8 *& p) {
+	t::uint64 v = readU(p);
+	return t::int64(v >> 1) ^ -t::int64(v & 1);
+}
+
+
+/**
+ * @class CompactLineTable
+ * Read-only line table using about 4 to 8 bytes per row instead of the
+ * 40 bytes of DebugLine::LineNumber, for binaries with huge line tables.
+ * It is used by the compilation units of a DebugLine in compact mode in place
+ * of the table of LineNumber: see DebugLine::CompilationUnit::compactLines().
+ *
+ * The sequences of rows are sorted by address and encoded as a byte stream:
+ * each row is made of a header byte packing the flags and the fields that
+ * changed, followed by the variable-length deltas of the address and of the
+ * line, and, if changed, the file index and the column. The rows are grouped
+ * in blocks of block_size rows starting with an anchor providing the full
+ * state of the first row: a lookup performs a binary search on the anchors
+ * and decodes a single block in the usual case. The LineNumber objects are
+ * rebuilt on access.
+ *
+ * A table is filled with a CompactLineTable::Builder. It refers to the
+ * DebugLine::File objects of the rows, that must remain alive as long as the
+ * table is used.
+ */
+
+// definition of the constant used by reference (min())
+const int CompactLineTable::block_size;
+
+/**
+ * Build an empty table.
+ */
+CompactLineTable::CompactLineTable(): _count(0), _bytes(nullptr), _size(0) {
+}
+
+///
+CompactLineTable::~CompactLineTable() {
+	delete [] _bytes;
+}
+
+/**
+ * @fn int CompactLineTable::count() const;
+ * Get the number of rows in the table (including the rows ending the
+ * sequences).
+ * @return	Row count.
+ */
+
+/**
+ * Get a row of the table. The rows are ordered by sequence address.
+ * The cost is the decoding of at most block_size rows.
+ * @param i		Index of the row.
+ * @return		Rebuilt row.
+ */
+CompactLineTable::LineNumber CompactLineTable::get(int i) const {
+	ASSERT(0 <= i && i < _count);
+	const anchor_t& a = _anchors[i / block_size];
+	row_t r = { a.addr, a.file, a.line, a.col, 0, 0, 0, 0 };
+	const t::uint8 *p = &_bytes[a.offset];
+	for(int j = i % block_size; j >= 0; j--)
+		decode(p, r);
+	return make(r);
+}
+
+/**
+ * @fn LineNumber CompactLineTable::operator[](int i) const;
+ * Same as get().
+ */
+
+/**
+ * Find the row covering the given address. The cost is a binary search
+ * on the blocks and the decoding of one block (more if sequences overlap
+ * the address).
+ * @param addr	Looked address.
+ * @param line	Set to the found row.
+ * @return		True if a row is found, false else.
+ */
+bool CompactLineTable::lineAt(address_t addr, LineNumber& line) const {
+	int n = _anchors.count();
+
+	// first block covering code after addr
+	int l = 0, h = n;
+	while(l < h) {
+		int m = (l + h) / 2;
+		if(_anchors[m].top <= addr)
+			l = m + 1;
+		else
+			h = m;
+	}
+
+	// look in the blocks that may cover addr
+	for(int b = l; b < n && _anchors[b].low <= addr; b++) {
+		const anchor_t& a = _anchors[b];
+		row_t prev, r = { a.addr, a.file, a.line, a.col, 0, 0, 0, 0 };
+		const t::uint8 *p = &_bytes[a.offset];
+		int cnt = min(block_size, _count - b * block_size);
+		for(int j = 0; j < cnt; j++) {
+			decode(p, r);
+			if(j != 0 && !(prev.flags & LineNumber::END_SEQUENCE)
+			&& prev.addr <= addr && addr < r.addr) {
+				line = make(prev);
+				return true;
+			}
+			prev = r;
+		}
+		if(b + 1 < n && !(prev.flags & LineNumber::END_SEQUENCE)
+		&& prev.addr <= addr && addr < _anchors[b + 1].addr) {
+			line = make(prev);
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Compute the memory used by the table.
+ * @return	Used memory (in bytes).
+ */
+size_t CompactLineTable::footprint() const {
+	return sizeof(*this)
+		+ _size
+		+ _anchors.count() * sizeof(anchor_t)
+		+ _files.count() * sizeof(DebugLine::File *);
+}
+
+/**
+ * @class CompactLineTable::Iter
+ * Iterator on the rows of a compact line table, in table order. The rows
+ * are decoded sequentially: a whole traversal costs O(n).
+ */
+
+/**
+ * Build an iterator on the rows of the table.
+ * @param table		Table to iterate on.
+ */
+CompactLineTable::Iter::Iter(const CompactLineTable& table)
+: _t(table), _i(0), _p(table._bytes) {
+	if(!ended()) {
+		const anchor_t& a = _t._anchors[0];
+		_r = { a.addr, a.file, a.line, a.col, 0, 0, 0, 0 };
+		_t.decode(_p, _r);
+	}
+}
+
+/**
+ * Go to the next row.
+ */
+void CompactLineTable::Iter::next() {
+	_i++;
+	if(ended())
+		return;
+	if(_i % block_size == 0) {
+		const anchor_t& a = _t._anchors[_i / block_size];
+		_r = { a.addr, a.file, a.line, a.col, 0, 0, 0, 0 };
+	}
+	_t.decode(_p, _r);
+}
+
+
+/**
+ * Decode a row.
+ * @param p		Pointer on the row bytes (moved after the row).
+ * @param r		Previous row as input, decoded row as output.
+ */
+void CompactLineTable::decode(const t::uint8 *& p, row_t& r) const {
+	t::uint8 h = *p++;
+	r.flags = h & flag_mask;
+	r.addr += readS(p);
+	r.line += t::int32(readS(p));
+	if(h & file_changed)
+		r.file = t::uint32(readU(p));
+	if(h & col_changed)
+		r.col = t::int32(readU(p));
+	if(h & has_extra) {
+		r.isa = *p++;
+		r.disc = *p++;
+		r.opi = *p++;
+	}
+	else
+		r.isa = r.disc = r.opi = 0;
+}
+
+/**
+ * Rebuild a line number from a decoded row.
+ * @param r		Decoded row.
+ * @return		Line number.
+ */
+CompactLineTable::LineNumber CompactLineTable::make(const row_t& r) const {
+	return LineNumber(r.addr, _files[r.file], r.line, r.col, r.flags, r.isa, r.disc, r.opi);
+}
+
+
+/**
+ * @class CompactLineTable::Builder
+ * Encoder of the rows of a compact line table. The rows are added in the
+ * order of the line program and the table is built by finish(): the
+ * builder only keeps a small fixed-size record per row meanwhile.
+ */
+
+/**
+ * Build a builder for the given table.
+ * @param table	Table to fill (must be empty).
+ */
+CompactLineTable::Builder::Builder(CompactLineTable& table)
+: tab(table), seq_start(0), pending(false), pending_block(0) {
+	ASSERT(tab._count == 0);
+}
+
+/**
+ * Add a row. The row ending a sequence must have the END_SEQUENCE flag set.
+ * @param l		Added row.
+ */
+void CompactLineTable::Builder::add(const LineNumber& l) {
+	row_t r;
+	r.addr = l.addr();
+	r.file = fileIndex(l.file());
+	r.line = l.line();
+	r.col = l.col();
+	r.flags = l.flags() & flag_mask;
+	r.isa = l.isa();
+	r.disc = l.discriminator();
+	r.opi = l.op_index();
+	rows.add(r);
+	if(r.flags & LineNumber::END_SEQUENCE) {
+		seqs.add({ seq_start, rows.count() - 1 });
+		seq_start = rows.count();
+	}
+}
+
+/**
+ * Encode the added rows in the table. The last sequence, if not ended, is
+ * ended by its last row.
+ */
+void CompactLineTable::Builder::finish() {
+	if(seq_start < rows.count())
+		seqs.add({ seq_start, rows.count() - 1 });
+
+	// encode the sequences by address
+	int n = seqs.count();
+	if(n != 0)
+		std::stable_sort(&seqs[0], &seqs[0] + n, [this](const seq_t& a, const seq_t& b)
+			{ return rows[a.b].addr < rows[b.b].addr; });
+	for(const auto& s: seqs)
+		if(s.b < s.e)
+			for(int i = s.b; i <= s.e; i++) {
+				row_t r = rows[i];
+				if(i == s.e)
+					r.flags |= LineNumber::END_SEQUENCE;
+				encode(r);
+			}
+
+	// compute the lookup information of the anchors
+	n = tab._anchors.count();
+	address_t top = 0;
+	for(int i = 0; i < n; i++) {
+		top = max(top, cover[i].snd);
+		tab._anchors[i].top = top;
+	}
+	address_t low = type_info<address_t>::max;
+	for(int i = n - 1; i >= 0; i--) {
+		low = min(low, cover[i].fst);
+		tab._anchors[i].low = low;
+	}
+
+	// copy the stream at its exact size
+	tab._size = bytes.count();
+	if(tab._size != 0) {
+		tab._bytes = new t::uint8[tab._size];
+		std::memcpy(tab._bytes, &bytes[0], tab._size);
+	}
+	rows.clear();
+	bytes.clear();
+}
+
+/**
+ * Append a row to the byte stream.
+ * @param r		Appended row.
+ */
+void CompactLineTable::Builder::encode(const row_t& r) {
+
+	// the pending row ends at this one
+	if(pending) {
+		auto& pc = cover[pending_block];
+		pc.fst = min(pc.fst, prev.addr);
+		pc.snd = max(pc.snd, r.addr);
+		pending = false;
+	}
+
+	// start a new block
+	if(tab._count % block_size == 0) {
+		anchor_t a;
+		a.addr = r.addr;
+		a.top = 0;
+		a.low = 0;
+		a.offset = bytes.count();
+		a.file = r.file;
+		a.line = r.line;
+		a.col = r.col;
+		tab._anchors.add(a);
+		cover.add(pair(type_info<address_t>::max, address_t(0)));
+		prev = r;
+	}
+
+	// encode the row
+	t::uint8 h = r.flags;
+	if(r.file != prev.file)
+		h |= file_changed;
+	if(r.col != prev.col)
+		h |= col_changed;
+	if(r.isa != 0 || r.disc != 0 || r.opi != 0)
+		h |= has_extra;
+	bytes.add(h);
+	writeS(bytes, t::int64(r.addr - prev.addr));
+	writeS(bytes, t::int64(r.line) - prev.line);
+	if(h & file_changed)
+		writeU(bytes, r.file);
+	if(h & col_changed)
+		writeU(bytes, t::uint32(r.col));
+	if(h & has_extra) {
+		bytes.add(r.isa);
+		bytes.add(r.disc);
+		bytes.add(r.opi);
+	}
+
+	// prepare the next row
+	if(!(r.flags & LineNumber::END_SEQUENCE)) {
+		pending = true;
+		pending_block = tab._anchors.count() - 1;
+	}
+	prev = r;
+	tab._count++;
+}
+
+/**
+ * Get the index of a file in the table, adding it if needed.
+ * @param file	Looked file.
+ * @return		File index.
+ */
+t::uint32 CompactLineTable::Builder::fileIndex(DebugLine::File *file) {
+	int i = files.get(file, -1);
+	if(i < 0) {
+		i = tab._files.count();
+		tab._files.add(file);
+		files.put(file, i);
+	}
+	return i;
+}
+
+}	// gel
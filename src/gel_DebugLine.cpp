@@ -17,8 +17,11 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>
+#include <elm/compare.h>
 #include <elm/data/util.h>
 
+#include <gel++/CompactLineTable.h>
 #include <gel++/DebugLine.h>
 
 namespace gel {
@@ -53,20 +56,180 @@ namespace gel {
  * @return	Compilation units using the source file.
  */
 
+///
+DebugLine::File::~File() {
+	delete _ranges.load();
+}
+
 /**
  * Find the address ranges corresponding to the given line number in the current file.
  * @param line	Looked line in the current source file.
  * @param addrs	Used to return the code ranges corresponding to the line.
  */
 void DebugLine::File::find(int line, Vector<Pair<address_t, address_t> >& addrs) const {
-	for(auto cu: _units) {
-		const auto& lines = cu->lines();
-		for(int i = 0; i < lines.count() - 1; i++)
-			if(lines[i].file() == this && lines[i].line() == line)
-				addrs.add(pair(lines[i].addr(), lines[i+1].addr()));
+	const auto& tab = ranges();
+	for(int i = lowerBound(0, line, 0); i < tab.count() && tab[i].line() == line; i++)
+		addrs.add(pair(tab[i].base(), tab[i].top()));
+}
+
+/**
+ * Find the address ranges corresponding to the given line and column numbers
+ * in the current file.
+ * @param line	Looked line in the current source file.
+ * @param col	Looked column in the line.
+ * @param addrs	Used to return the code ranges corresponding to the line.
+ */
+void DebugLine::File::find(int line, int col, Vector<Pair<address_t, address_t> >& addrs) const {
+	const auto& tab = ranges();
+	for(int i = lowerBound(0, line, col);
+	i < tab.count() && tab[i].line() == line && tab[i].col() == col; i++)
+		addrs.add(pair(tab[i].base(), tab[i].top()));
+}
+
+/**
+ * Find the address ranges of several lines at once. For each looked line,
+ * a span (begin index, end index excluded) of the array returned by ranges()
+ * is added to spans. The lookup is faster when the lines are sorted in
+ * increasing order.
+ * @param lines	Looked lines.
+ * @param spans	Used to return the spans of the line ranges.
+ */
+void DebugLine::File::find(const Vector<int>& lines, Vector<Pair<int, int> >& spans) const {
+	int b = 0;
+	for(int i = 0; i < lines.count(); i++) {
+		if(i == 0 || lines[i] < lines[i - 1])
+			b = 0;
+		b = lowerBound(b, lines[i], 0);
+		int e = lowerBound(b, lines[i] + 1, 0);
+		spans.add(pair(b, e));
 	}
 }
 
+/**
+ * Get the address ranges of the lines of the file, sorted by line, column
+ * and address. The array is built at the first call from the lines of the
+ * compilation units using the file: contiguous ranges of the same line and
+ * column are merged. The building is protected by the debug line owning
+ * the compilation units of the file.
+ * @return	Address ranges of the file lines.
+ */
+const Vector<DebugLine::LineRange>& DebugLine::File::ranges() const {
+	static const Vector<LineRange> empty;
+	if(_units.isEmpty())
+		return empty;
+	Vector<LineRange> *tab = _ranges.load(std::memory_order_acquire);
+	if(tab == nullptr) {
+		std::lock_guard<std::mutex> guard(_units.first()->_dl->_ranges_mutex);
+		tab = _ranges.load(std::memory_order_relaxed);
+		if(tab == nullptr) {
+			tab = new Vector<LineRange>();
+
+			// collect the ranges
+			for(auto cu: _units) {
+				if(!cu->_dl->isCompact()) {
+					const auto& lines = cu->lines();
+					for(int i = 0; i < lines.count() - 1; i++)
+						if(lines[i].file() == this
+						&& !(lines[i].flags() & LineNumber::END_SEQUENCE)
+						&& lines[i].addr() < lines[i + 1].addr())
+							tab->add(LineRange(lines[i].line(), lines[i].col(), lines[i].addr(), lines[i + 1].addr()));
+					continue;
+				}
+				auto compact = cu->compactLines();
+				if(compact != nullptr && compact->count() != 0) {
+					CompactLineTable::Iter i(*compact);
+					LineNumber l = i.item();
+					for(i.next(); !i.ended(); i.next()) {
+						LineNumber n = i.item();
+						if(l.file() == this
+						&& !(l.flags() & LineNumber::END_SEQUENCE)
+						&& l.addr() < n.addr())
+							tab->add(LineRange(l.line(), l.col(), l.addr(), n.addr()));
+						l = n;
+					}
+				}
+			}
+
+			// sort them and merge the contiguous ones
+			int n = tab->count();
+			if(n != 0) {
+				std::sort(&(*tab)[0], &(*tab)[0] + n,
+					[](const LineRange& a, const LineRange& b) {
+						if(a.line() != b.line())
+							return a.line() < b.line();
+						if(a.col() != b.col())
+							return a.col() < b.col();
+						return a.base() < b.base();
+					});
+				int j = 0;
+				for(int i = 1; i < n; i++) {
+					LineRange& r = (*tab)[j];
+					const LineRange& c = (*tab)[i];
+					if(c.line() == r.line() && c.col() == r.col() && c.base() <= r.top())
+						r = LineRange(r.line(), r.col(), r.base(), max(r.top(), c.top()));
+					else
+						(*tab)[++j] = c;
+				}
+				tab->setLength(j + 1);
+			}
+			_ranges.store(tab, std::memory_order_release);
+		}
+	}
+	return *tab;
+}
+
+/**
+ * Find the first range, from index b, whose line and column are greater
+ * or equal to the given ones.
+ * @param b		Index to start the lookup from.
+ * @param line	Looked line.
+ * @param col	Looked column.
+ * @return		Found index (count of ranges if not found).
+ */
+int DebugLine::File::lowerBound(int b, int line, int col) const {
+	const auto& tab = ranges();
+	int h = tab.count();
+	while(b < h) {
+		int m = (b + h) / 2;
+		if(tab[m].line() < line || (tab[m].line() == line && tab[m].col() < col))
+			b = m + 1;
+		else
+			h = m;
+	}
+	return b;
+}
+
+
+/**
+ * @class DebugLine::LineRange
+ * Address range of the code of a source line and column, as returned by
+ * DebugLine::File::ranges().
+ */
+
+/**
+ * @fn int DebugLine::LineRange::line() const;
+ * Get the source line.
+ * @return	Source line.
+ */
+
+/**
+ * @fn int DebugLine::LineRange::col() const;
+ * Get the source column.
+ * @return	Source column.
+ */
+
+/**
+ * @fn address_t DebugLine::LineRange::base() const;
+ * Get the base address of the code.
+ * @return	Base address.
+ */
+
+/**
+ * @fn address_t DebugLine::LineRange::top() const;
+ * Get the top address (excluded) of the code.
+ * @return	Top address.
+ */
+
 
 /**
  * @class DebugLine::LineNumber
@@ -98,8 +261,8 @@ t::uint32 flags, t::uint8 isa, t::uint8 desc, t::uint8 opi)
 /**
  * @fn t::uint32 DebugLine::LineNumber::flags() const;
  * Get flags about this code.
- * @return	Code flags (combination of IS_STMT, BASIC_BLOCK, PROLOGUE_END
- * 			and EPILOGUE_BEGIN).
+ * @return	Code flags (combination of IS_STMT, BASIC_BLOCK, PROLOGUE_END,
+ * 			EPILOGUE_BEGIN and END_SEQUENCE).
  */
 
 /**
@@ -130,22 +293,75 @@ t::uint32 flags, t::uint8 isa, t::uint8 desc, t::uint8 opi)
  * @class CompilationUnit
  * Represents a compilation unit involved in the build of an executable or
  * of a dynamic library.
+ *
+ * The lines of a compilation unit may be decoded lazily by the DebugLine
+ * owning it: in this case, only the list of files is available at
+ * construction time, the address ranges and the lines being decoded at the
+ * first access.
+ *
+ * If the DebugLine is in compact mode, the lines are stored in a
+ * CompactLineTable (see compactLines()) instead of the table of LineNumber
+ * returned by lines(), that is then not available.
+ */
+
+/**
+ * Build an empty compilation unit.
  */
+DebugLine::CompilationUnit::CompilationUnit()
+	: _dl(nullptr), _compact(nullptr), _base(0), _top(0), _index(nullptr), _state(NONE) { }
+
+///
+DebugLine::CompilationUnit::~CompilationUnit() {
+	deleteAll(_defined);
+	delete _compact;
+	delete _index;
+}
 
 /**
- * @fn const FragTable<DebugLine::Line>& DebugLine::CompilationUnit::lines() const;
- * Get the array of lines in the compilation unit. Notice that the last entry
- * of this array does not represent an actual line but provides the top address of
- * the previous line.
+ * Get the array of lines in the compilation unit. A compilation unit may
+ * contain several sequences of lines: the last entry of each sequence has the
+ * END_SEQUENCE flag set and does not represent an actual line but provides
+ * the top address of the previous line.
+ *
+ * If the compilation unit is decoded lazily, the first call decodes the lines.
  * @return	Array of lines.
+ * @throw gel::Exception	In compact mode: the lines are provided by
+ * 							compactLines().
+ */
+const FragTable<DebugLine::LineNumber>& DebugLine::CompilationUnit::lines() const {
+	if(_dl->isCompact())
+		throw gel::Exception("lines() is not available in compact mode: use compactLines()");
+	_dl->require(this, LOADED);
+	return _lines;
+}
+
+/**
+ * Get the compact table of the lines of the compilation unit, if the
+ * DebugLine is in compact mode. The rows are the same as the ones of lines()
+ * in normal mode but the sequences are sorted by address.
+ *
+ * If the compilation unit is decoded lazily, the first call decodes the lines.
+ * @return	Compact line table or null if the DebugLine is not in compact mode.
  */
+const CompactLineTable *DebugLine::CompilationUnit::compactLines() const {
+	_dl->require(this, LOADED);
+	return _compact;
+}
 
 /**
  * @fn const Vector<DebugLine::File *>& DebugLine::CompilationUnit::files() const;
  * Get the list of source files involved in this compilation unit.
+ * The files defined by the line program (see DebugLine::define()) are not
+ * listed: they are only reachable from the lines.
  * @return	List of compilation units.
  */
 
+/**
+ * @fn bool DebugLine::CompilationUnit::isLoaded() const;
+ * Test if the lines of the compilation unit are decoded.
+ * @return	True if the lines are decoded, false else.
+ */
+
 /**
  * Add a debug information line number to the compilation unit.
  * @param num	Line number information to add.
@@ -154,6 +370,16 @@ void DebugLine::CompilationUnit::add(const LineNumber& num) {
 	_lines.add(num);
 }
 
+/**
+ * Set the compact table of the lines of the compilation unit (in compact
+ * mode). The unit becomes owner of the table.
+ * @param lines	Compact line table.
+ */
+void DebugLine::CompilationUnit::add(CompactLineTable *lines) {
+	delete _compact;
+	_compact = lines;
+}
+
 /**
  * Add a source file to the compilation unit.
  * @param file	Added file.
@@ -164,19 +390,49 @@ void DebugLine::CompilationUnit::add(File *file) {
 }
 
 /**
- * Get the base address of the compilation unit.
+ * Add an address range covered by the code of the compilation unit.
+ * @param base	Base address of the range.
+ * @param top	Top address (excluded) of the range.
+ */
+void DebugLine::CompilationUnit::addRange(address_t base, address_t top) {
+	if(_ranges.count() == 0) {
+		_base = base;
+		_top = top;
+	}
+	else {
+		_base = min(_base, base);
+		_top = max(_top, top);
+	}
+	_ranges.add(pair(base, top));
+}
+
+/**
+ * Get the address ranges covered by the code of the compilation unit.
+ * @return	Address ranges (base address, top address excluded).
+ */
+const Vector<Pair<address_t, address_t> >& DebugLine::CompilationUnit::ranges() const {
+	_dl->require(this, BOUND);
+	return _ranges;
+}
+
+/**
+ * Get the base address of the compilation unit, that is, the lowest address
+ * of its ranges.
  * @return	Base address.
  */
 address_t DebugLine::CompilationUnit::baseAddress() const {
-	return _lines[0].addr();
+	_dl->require(this, BOUND);
+	return _base;
 }
 
 /**
- * Get the top address of the compilation unit.
+ * Get the top address of the compilation unit, that is, the highest end
+ * address of its ranges.
  * @return	Top address.
  */
 address_t DebugLine::CompilationUnit::topAddress() const {
-	return _lines[_lines.count() - 1].addr();
+	_dl->require(this, BOUND);
+	return _top;
 }
 
 /**
@@ -187,60 +443,418 @@ address_t DebugLine::CompilationUnit::topAddress() const {
 
 /**
  * Find the line description corresponding to the given address.
- * @return	Found line number or null pointer.
+ * The first call builds the address index of the unit lines.
+ * @param addr	Looked address.
+ * @return		Found line number or null pointer.
+ * @throw gel::Exception	In compact mode, as no LineNumber is stored: the
+ * 							other form of lineAt() has to be used.
  */
 const DebugLine::LineNumber *DebugLine::CompilationUnit::lineAt(address_t addr) const {
-	for(int i = 0; i < _lines.count() - 1; i++)
-		if(_lines[i].addr() <= addr && addr < _lines[i+1].addr())
-			return &_lines[i];
+	if(_dl->isCompact())
+		throw gel::Exception("lineAt() is not available in compact mode: use lineAt(address_t, LineNumber&)");
+	const line_index_t& tab = index();
+
+	// find the first entry after addr
+	int l = 0, h = tab.count();
+	while(l < h) {
+		int m = (l + h) / 2;
+		if(tab[m].lo <= addr)
+			l = m + 1;
+		else
+			h = m;
+	}
+
+	// look back the entries that may contain addr
+	for(int i = l - 1; i >= 0 && addr < tab[i].top; i--)
+		if(addr < tab[i].hi)
+			return tab[i].line;
 	return nullptr;
 }
 
+/**
+ * Find the line description corresponding to the given address.
+ * Contrary to the other form, this one also works in compact mode.
+ * @param addr	Looked address.
+ * @param line	Set to the found line.
+ * @return		True if a line is found, false else.
+ */
+bool DebugLine::CompilationUnit::lineAt(address_t addr, LineNumber& line) const {
+	if(_dl->isCompact()) {
+		auto compact = compactLines();
+		return compact != nullptr && compact->lineAt(addr, line);
+	}
+	auto l = lineAt(addr);
+	if(l == nullptr)
+		return false;
+	line = *l;
+	return true;
+}
 
 /**
- * @class DebugLine::StateMachine
- * Only for internal use.
+ * Get the address index of the lines, building it if needed.
+ * @return	Line index.
  */
+const DebugLine::line_index_t& DebugLine::CompilationUnit::index() const {
+	_dl->require(this, INDEXED);
+	return *_index;
+}
+
+/**
+ * Remove the decoded lines (and the ranges) after a decoding failure.
+ * @param ranges	True to also remove the ranges.
+ */
+void DebugLine::CompilationUnit::reset(bool ranges) {
+	_lines.clear();
+	delete _compact;
+	_compact = nullptr;
+	if(ranges) {
+		_ranges.clear();
+		_base = _top = 0;
+	}
+}
+
+/**
+ * Build the address index of the lines of the unit. The index contains
+ * one entry for each line covering some code, that is, the last row of
+ * a sequence and the rows followed by a row at the same address are ignored.
+ * Entries are sorted by base address and record the highest top address of
+ * the preceding entries: this allows the lookups to handle the rare sequences
+ * overlapping each other.
+ */
+void DebugLine::CompilationUnit::buildIndex() {
+	line_index_t *tab = new line_index_t;
+
+	// collect the entries
+	for(int i = 0; i < _lines.count() - 1; i++)
+		if(!(_lines[i].flags() & LineNumber::END_SEQUENCE)
+		&& _lines[i].addr() < _lines[i + 1].addr()) {
+			line_entry_t e;
+			e.lo = _lines[i].addr();
+			e.hi = _lines[i + 1].addr();
+			e.line = &_lines[i];
+			tab->add(e);
+		}
+
+	// sort them and compute the running top
+	int n = tab->count();
+	if(n != 0) {
+		std::stable_sort(&(*tab)[0], &(*tab)[0] + n,
+			[](const line_entry_t& a, const line_entry_t& b) { return a.lo < b.lo; });
+		address_t top = 0;
+		for(int i = 0; i < n; i++) {
+			top = max(top, (*tab)[i].hi);
+			(*tab)[i].top = top;
+		}
+	}
+	_index = tab;
+}
 
 
 /**
  * @class DebugLine
  * Provides access to debug source line information of an ELF file.
+ *
+ * Address lookups go through two sorted indexes: the first one maps the
+ * address ranges to the compilation units and is built at the first lookup,
+ * the second one maps the addresses to the lines of a compilation unit and is
+ * built at the first lookup in the unit. Both cost O(log n).
+ *
+ * The compilation units may be added already decoded (add()) or in
+ * deferred mode (defer()): in the latter case, the lines of a unit are decoded
+ * by load() only when they are needed, that is, when a lookup hits its
+ * address ranges or when one of its files is queried. If the address ranges
+ * of the unit are not known either, they are obtained by calling bound().
+ * As the decoding is performed on demand, a decoding error may be raised by
+ * the query functions in deferred mode.
+ *
+ * In compact mode, the lines of the units are stored in CompactLineTable
+ * objects, using 4 to 8 bytes per row instead of the 40 bytes of a
+ * LineNumber: this mode is useful for huge binaries. The lines are then
+ * retrieved with lineAt(address_t, LineNumber&), File::ranges() and
+ * CompilationUnit::compactLines() while lineAt(address_t), linesIn() and
+ * CompilationUnit::lines(), that return stored LineNumber, throw an
+ * exception.
  */
 
 /**
  * Build source line debug information for the given ELF file.
- * @param efile
+ * @param efile		File containing the debug information.
+ * @param compact	True to store the lines in compact form.
  */
-DebugLine::DebugLine(gel::File *efile): prog(*efile) {
+DebugLine::DebugLine(gel::File *efile, bool compact): prog(*efile), _compact(compact), _index(nullptr) {
 }
 
 ///
 DebugLine::~DebugLine() {
+	delete _index.load();
 	deleteAll(_files);
 	deleteAll(_cus);
 }
 
 /**
- * Find the line at the given address.
- * @return	Found line or null.
+ * Find the line at the given address. The first call builds the address
+ * index of the compilation units so that the lookup costs O(log n).
+ * @param addr	Looked address.
+ * @return		Found line or null.
+ * @throw gel::Exception	In compact mode (see the other form of lineAt()).
  */
 const DebugLine::LineNumber *DebugLine::lineAt(address_t addr) const {
-	for(auto unit: _cus)
-		if(unit->baseAddress() <= addr && addr < unit->topAddress())
-			return unit->lineAt(addr);
+	if(_compact)
+		throw gel::Exception("lineAt() is not available in compact mode: use lineAt(address_t, LineNumber&)");
+	const unit_index_t& tab = index();
+
+	// find the first entry after addr
+	int l = 0, h = tab.count();
+	while(l < h) {
+		int m = (l + h) / 2;
+		if(tab[m].lo <= addr)
+			l = m + 1;
+		else
+			h = m;
+	}
+
+	// look back the entries that may contain addr
+	for(int i = l - 1; i >= 0 && addr < tab[i].top; i--)
+		if(addr < tab[i].hi) {
+			auto line = tab[i].unit->lineAt(addr);
+			if(line != nullptr)
+				return line;
+		}
 	return nullptr;
 }
 
+/**
+ * Find the line at the given address. Contrary to the other form, this one
+ * also works in compact mode.
+ * @param addr	Looked address.
+ * @param line	Set to the found line.
+ * @return		True if a line is found, false else.
+ */
+bool DebugLine::lineAt(address_t addr, LineNumber& line) const {
+	const unit_index_t& tab = index();
+	int l = 0, h = tab.count();
+	while(l < h) {
+		int m = (l + h) / 2;
+		if(tab[m].lo <= addr)
+			l = m + 1;
+		else
+			h = m;
+	}
+	for(int i = l - 1; i >= 0 && addr < tab[i].top; i--)
+		if(addr < tab[i].hi && tab[i].unit->lineAt(addr, line))
+			return true;
+	return false;
+}
+
+/**
+ * Get the lines whose code intersects the given address range, in
+ * increasing address order. The first call builds the address index of the
+ * compilation units: then getting the first line costs O(log n).
+ *
+ * The returned iterator also provides the address range of each line
+ * (LineIter::address() and LineIter::topAddress()).
+ *
+ * @param lo	Base address of the range.
+ * @param hi	Top address of the range (excluded).
+ * @return		Range of lines.
+ * @throw gel::Exception	In compact mode.
+ */
+Range<DebugLine::LineIter> DebugLine::linesIn(address_t lo, address_t hi) const {
+	if(_compact)
+		throw gel::Exception("linesIn() is not available in compact mode");
+	const unit_index_t& tab = index();
+
+	// first entry whose code may end after lo
+	int l = 0, h = tab.count();
+	while(l < h) {
+		int m = (l + h) / 2;
+		if(tab[m].top <= lo)
+			l = m + 1;
+		else
+			h = m;
+	}
+	int b = l;
+
+	// first entry starting at or after hi
+	h = tab.count();
+	while(l < h) {
+		int m = (l + h) / 2;
+		if(tab[m].lo < hi)
+			l = m + 1;
+		else
+			h = m;
+	}
+
+	return range(LineIter(tab, b, l, lo, hi), LineIter(tab, l, l, lo, hi));
+}
 
 /**
- * Add a compilation unit.
+ * Get the address index of the compilation units, building it at the first
+ * call. The index contains one entry for each address range of each unit,
+ * sorted by base address, and records the highest top address of the
+ * preceding entries. Building the index requires the address ranges of all
+ * units but does not decode their lines.
+ * @return	Unit index.
+ */
+const DebugLine::unit_index_t& DebugLine::index() const {
+	unit_index_t *tab = _index.load(std::memory_order_acquire);
+	if(tab == nullptr) {
+		std::lock_guard<std::mutex> guard(_index_mutex);
+		tab = _index.load(std::memory_order_relaxed);
+		if(tab == nullptr) {
+			boundAll();
+			tab = new unit_index_t;
+
+			// collect the entries
+			for(auto cu: _cus)
+				for(const auto& r: cu->ranges())
+					if(r.fst < r.snd) {
+						unit_entry_t e;
+						e.lo = r.fst;
+						e.hi = r.snd;
+						e.unit = cu;
+						tab->add(e);
+					}
+
+			// sort them and compute the running top
+			int n = tab->count();
+			if(n != 0) {
+				std::stable_sort(&(*tab)[0], &(*tab)[0] + n,
+					[](const unit_entry_t& a, const unit_entry_t& b) { return a.lo < b.lo; });
+				address_t top = 0;
+				for(int i = 0; i < n; i++) {
+					top = max(top, (*tab)[i].hi);
+					(*tab)[i].top = top;
+				}
+			}
+			_index.store(tab, std::memory_order_release);
+		}
+	}
+	return *tab;
+}
+
+/**
+ * Ensure that a compilation unit reaches the given state, decoding what is
+ * needed. The states are, in order, NONE (only the files are known), BOUND
+ * (the address ranges are known), LOADED (the lines are decoded) and INDEXED
+ * (the address index of the lines is built).
+ * @param ccu	Compilation unit to look at.
+ * @param state	Required state.
+ */
+void DebugLine::require(const CompilationUnit *ccu, int state) const {
+	if(ccu->_state.load(std::memory_order_acquire) >= state)
+		return;
+	std::lock_guard<std::mutex> guard(_load_mutex);
+	CompilationUnit *cu = const_cast<CompilationUnit *>(ccu);
+	DebugLine *self = const_cast<DebugLine *>(this);
+	int s = cu->_state.load(std::memory_order_relaxed);
+	try {
+		if(s < BOUND && state == BOUND) {
+			self->bound(cu);
+			s = BOUND;
+		}
+		if(s < LOADED && state >= LOADED) {
+			self->load(cu, s < BOUND);
+			s = LOADED;
+		}
+	}
+	catch(...) {
+		cu->reset(s < BOUND);
+		throw;
+	}
+	if(s < INDEXED && state >= INDEXED) {
+		cu->buildIndex();
+		s = INDEXED;
+	}
+	cu->_state.store(s, std::memory_order_release);
+}
+
+/**
+ * Ensure that the address ranges of all compilation units are known,
+ * bounding the units in deferred mode in one call to bound().
+ */
+void DebugLine::boundAll() const {
+	Vector<CompilationUnit *> cus;
+	std::lock_guard<std::mutex> guard(_load_mutex);
+	for(auto cu: _cus)
+		if(cu->_state.load(std::memory_order_relaxed) < BOUND)
+			cus.add(cu);
+	if(cus.count() == 0)
+		return;
+	try {
+		const_cast<DebugLine *>(this)->bound(cus);
+	}
+	catch(...) {
+		for(auto cu: cus)
+			cu->reset(true);
+		throw;
+	}
+	for(auto cu: cus)
+		cu->_state.store(BOUND, std::memory_order_release);
+}
+
+/**
+ * Add a compilation unit whose lines are already decoded. If no address
+ * range has been added to the unit, its range is computed from its lines.
  * @param cu	Added compilation unit.
  */
 void DebugLine::add(CompilationUnit *cu) {
+	cu->_dl = this;
+	if(cu->_ranges.count() == 0 && cu->_lines.count() != 0) {
+		address_t base = cu->_lines[0].addr(), top = base;
+		for(const auto& l: cu->_lines) {
+			base = min(base, l.addr());
+			top = max(top, l.addr());
+		}
+		cu->addRange(base, top);
+	}
+	cu->_state.store(LOADED, std::memory_order_release);
+	_cus.add(cu);
+}
+
+/**
+ * Add a compilation unit whose lines will be decoded on demand by load().
+ * @param cu	Added compilation unit.
+ * @param bound	True if the address ranges of the unit are already set,
+ * 				false if they have to be obtained from bound().
+ */
+void DebugLine::defer(CompilationUnit *cu, bool bound) {
+	cu->_dl = this;
+	cu->_state.store(bound ? BOUND : NONE, std::memory_order_release);
 	_cus.add(cu);
 }
 
+/**
+ * Called to get the address ranges of a compilation unit added in deferred
+ * mode. The default implementation decodes the whole unit with load().
+ * @param cu	Compilation unit to get ranges for.
+ */
+void DebugLine::bound(CompilationUnit *cu) {
+	load(cu, true);
+}
+
+/**
+ * Called to get the address ranges of several compilation units added in
+ * deferred mode. The default implementation calls bound() on each unit:
+ * this may be overridden to bound the units in parallel.
+ * @param cus	Compilation units to get ranges for.
+ */
+void DebugLine::bound(const Vector<CompilationUnit *>& cus) {
+	for(auto cu: cus)
+		bound(cu);
+}
+
+/**
+ * Called to decode the lines of a compilation unit added in deferred mode.
+ * The lines have to be added with CompilationUnit::add(const LineNumber&).
+ * The default implementation does nothing.
+ * @param cu		Compilation unit to decode.
+ * @param ranges	True if the address ranges of the unit have also to be
+ * 					added (with CompilationUnit::addRange()).
+ */
+void DebugLine::load(CompilationUnit *cu, bool ranges) {
+}
+
 /**
  * Add a source file.
  * @param file	Source ile to add.
@@ -249,6 +863,24 @@ void DebugLine::add(File *file) {
 	_files.put(file->path(), file);
 }
 
+/**
+ * Create a source file defined while decoding the lines of a compilation
+ * unit. As the lines may be decoded on demand, concurrently with queries,
+ * the file is neither added to the debug line nor to the file list of the
+ * unit: it is owned by the unit and only reachable from its lines.
+ * @param cu	Compilation unit defining the file.
+ * @param path	File path.
+ * @param date	File modification date.
+ * @param size	File size.
+ * @return		Created file.
+ */
+DebugLine::File *DebugLine::define(CompilationUnit *cu, sys::Path path, t::uint64 date, size_t size) {
+	auto file = new File(path, date, size);
+	file->_units.add(cu);
+	cu->_defined.add(file);
+	return file;
+}
+
 /**
  * @fn const HashMap<sys::Path, File *>& DebugLine::files() const;
  * Get the list of source files involved in the current ELF file.
@@ -261,6 +893,87 @@ void DebugLine::add(File *file) {
  * @return	List of compilation units.
  */
 
-}	// gel
 
+/**
+ * @class DebugLine::LineIter
+ * Iterator on the lines of an address range returned by DebugLine::linesIn().
+ * The iterator walks the address ranges of the compilation units intersecting
+ * the range and, in each one, the lines intersecting the range.
+ */
+
+/**
+ * Build the iterator.
+ * @param units	Index of the units.
+ * @param i		First unit entry to look at.
+ * @param end	Top unit entry (excluded).
+ * @param lo	Base address of the range.
+ * @param hi	Top address (excluded) of the range.
+ */
+DebugLine::LineIter::LineIter(const unit_index_t& units, int i, int end, address_t lo, address_t hi)
+	: _units(units), _i(i), _end(end), _lines(nullptr), _j(0), _lo(lo), _hi(hi)
+{
+	start();
+	seek();
+}
+
+///
+void DebugLine::LineIter::next() {
+	_j++;
+	seek();
+}
+
+/**
+ * Position the iterator on the first line of the current unit entry
+ * that may intersect the range.
+ */
+void DebugLine::LineIter::start() {
+	if(_i >= _end)
+		return;
+	const unit_entry_t& e = _units[_i];
+	_lines = &e.unit->index();
+	address_t lo = max(_lo, e.lo);
+	int l = 0, h = _lines->count();
+	while(l < h) {
+		int m = (l + h) / 2;
+		if((*_lines)[m].top <= lo)
+			l = m + 1;
+		else
+			h = m;
+	}
+	_j = l;
+}
+
+/**
+ * Move to the next line intersecting the range, starting from the current
+ * position. A line is only reported in the unit entry containing its start
+ * (or the start of the range) to avoid duplicates.
+ */
+void DebugLine::LineIter::seek() {
+	while(_i < _end) {
+		const unit_entry_t& e = _units[_i];
+		address_t hi = min(_hi, e.hi);
+		for(; _j < _lines->count() && (*_lines)[_j].lo < hi; _j++) {
+			const line_entry_t& l = (*_lines)[_j];
+			if(l.hi > _lo && max(l.lo, _lo) >= e.lo)
+				return;
+		}
+		_i++;
+		start();
+	}
+	_j = 0;
+}
+
+/**
+ * @fn address_t DebugLine::LineIter::address() const;
+ * Get the base address of the code of the current line.
+ * @return	Base address.
+ */
+
+/**
+ * @fn address_t DebugLine::LineIter::topAddress() const;
+ * Get the top address (excluded) of the code of the current line.
+ * @return	Top address.
+ */
+
+}	// gel
 
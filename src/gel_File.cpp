@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <algorithm>
+#include <elm/compare.h>
 #include <gel++/File.h>
 #include <gel++/Image.h>
 
@@ -104,10 +106,223 @@ Symbol::~Symbol() {
  * Represents the table of symbols for an executable file.
  * This class is basically a hash map with the symbol name as keys.
  * All facilities of an ELM class map are provided.
+ *
+ * In addition, the symbols can be looked up by address with at() and
+ * nearest(). These functions use an index sorted by address that is built
+ * on the first address lookup: if the table is modified afterwards,
+ * invalidate() has to be called to rebuild it. The address lookups
+ * can be performed concurrently from several threads.
+ */
+
+// index of the symbols sorted by address
+class SymbolTable::Index {
+public:
+	typedef struct {
+		address_t lo, hi;
+		Symbol *sym;
+	} entry_t;
+
+	Index(const SymbolTable& table);
+	int upperBound(address_t a) const;
+
+	Vector<entry_t> ents;		// sorted by lo, then by decreasing hi
+	Vector<address_t> maxhi;	// maxhi[i] = max(ents[0..i].hi)
+	Vector<address_t> keys;		// lo in Eytzinger layout (1-based)
+	Vector<int> ranks;			// rank in ents of each key
+
+private:
+	static int weight(Symbol *s);
+	static bool before(const entry_t& e1, const entry_t& e2);
+	void fill(int& i, int k);
+};
+
+// preference between aliases (greater is better)
+int SymbolTable::Index::weight(Symbol *s) {
+	int w = 0;
+	switch(s->bind()) {
+	case Symbol::GLOBAL:	w = 30; break;
+	case Symbol::WEAK:		w = 20; break;
+	case Symbol::LOCAL:		w = 10; break;
+	default:				break;
+	}
+	switch(s->type()) {
+	case Symbol::FUNC:		w += 3; break;
+	case Symbol::DATA:		w += 2; break;
+	case Symbol::LABEL:		w += 1; break;
+	default:				break;
+	}
+	return w;
+}
+
+// order of the entries: by address, the biggest first, then the preferred alias
+bool SymbolTable::Index::before(const entry_t& e1, const entry_t& e2) {
+	if(e1.lo != e2.lo)
+		return e1.lo < e2.lo;
+	if(e1.hi != e2.hi)
+		return e1.hi > e2.hi;
+	int w1 = weight(e1.sym), w2 = weight(e2.sym);
+	if(w1 != w2)
+		return w1 > w2;
+	return e1.sym->name() < e2.sym->name();
+}
+
+SymbolTable::Index::Index(const SymbolTable& table) {
+
+	// collect the symbols denoting an address
+	Vector<Symbol *> syms;
+	table.collect(syms);
+	for(auto s: syms) {
+		if(s->type() == Symbol::OTHER_TYPE || s->name().isEmpty())
+			continue;
+		address_t lo = s->value(), hi = lo + s->size();
+		if(hi < lo)
+			hi = address_t(-1);
+		ents.add({ lo, hi, s });
+	}
+	if(ents.isEmpty())
+		return;
+
+	// sort them and only keep the preferred alias
+	std::sort(&ents[0], &ents[0] + ents.count(), before);
+	int j = 0;
+	for(int i = 1; i < ents.count(); i++)
+		if(ents[i].lo != ents[j].lo || ents[i].hi != ents[j].hi)
+			ents[++j] = ents[i];
+	ents.setLength(j + 1);
+
+	// prepare the overlap scan
+	maxhi.setLength(ents.count());
+	address_t m = 0;
+	for(int i = 0; i < ents.count(); i++) {
+		m = max(m, ents[i].hi);
+		maxhi[i] = m;
+	}
+
+	// build the search tree
+	keys.setLength(ents.count() + 1);
+	ranks.setLength(ents.count() + 1);
+	int i = 0;
+	fill(i, 1);
+}
+
+// fill the Eytzinger layout in-order
+void SymbolTable::Index::fill(int& i, int k) {
+	if(k < keys.count()) {
+		fill(i, 2 * k);
+		keys[k] = ents[i].lo;
+		ranks[k] = i++;
+		fill(i, 2 * k + 1);
+	}
+}
+
+// number of entries whose lower address is less or equal to a
+int SymbolTable::Index::upperBound(address_t a) const {
+	int n = keys.count(), k = 1;
+	while(k < n)
+		k = 2 * k + (keys[k] <= a);
+	while(k & 1)
+		k >>= 1;
+	k >>= 1;
+	return k == 0 ? ents.count() : ranks[k];
+}
+
+
+/**
+ * Build an empty symbol table.
  */
+SymbolTable::SymbolTable(): _index(nullptr) {
+}
 
 ///
 SymbolTable::~SymbolTable() {
+	delete _index.load();
+}
+
+/**
+ * Get the index by address, building it if needed.
+ * @return	Index by address.
+ */
+const SymbolTable::Index& SymbolTable::index() const {
+	Index *i = _index.load(std::memory_order_acquire);
+	if(i == nullptr) {
+		std::lock_guard<std::mutex> guard(_mutex);
+		i = _index.load(std::memory_order_relaxed);
+		if(i == nullptr) {
+			i = new Index(*this);
+			_index.store(i, std::memory_order_release);
+		}
+	}
+	return *i;
+}
+
+/**
+ * Invalidate the index by address. Must be called after the table
+ * has been modified if at() or nearest() has already been called.
+ * Must not be called while other threads perform address lookups.
+ */
+void SymbolTable::invalidate() {
+	std::lock_guard<std::mutex> guard(_mutex);
+	delete _index.exchange(nullptr);
+}
+
+/**
+ * Collect all the symbols of the table to build the index by address.
+ * The default implementation collects the symbols of the map. It has to be
+ * overridden by tables keeping several symbols with the same name.
+ * @param syms	Vector to add symbols to.
+ */
+void SymbolTable::collect(Vector<Symbol *>& syms) const {
+	for(auto s: *this)
+		syms.add(s);
+}
+
+/**
+ * Find the symbol containing the given address, that is the symbol
+ * whose value is less or equal to the address and whose value plus size
+ * is greater than the address. If several symbols contain the address,
+ * the innermost one is returned. A symbol of size 0 is only returned
+ * if its value is exactly the address and no sized symbol contains it.
+ * Among aliases (same value and size), global symbols are preferred to
+ * weak and local symbols, and functions to data and labels.
+ * Symbols of type OTHER_TYPE (sections, files, etc) are ignored.
+ * @param a		Looked address.
+ * @return		Found symbol or null.
+ */
+Symbol *SymbolTable::at(address_t a) const {
+	const Index& ind = index();
+	Symbol *exact = nullptr;
+	for(int i = ind.upperBound(a) - 1; i >= 0; i--) {
+		const auto& e = ind.ents[i];
+		if(ind.maxhi[i] <= a && e.lo < a)
+			break;
+		if(a < e.hi)
+			return e.sym;
+		if(e.lo == a && e.hi == a && exact == nullptr)
+			exact = e.sym;
+	}
+	return exact;
+}
+
+/**
+ * Find the symbol containing the given address or, if there is none,
+ * the symbol with the greatest value less or equal to the address
+ * (whatever its size). This is useful to label addresses of code that
+ * is not covered by sized symbols.
+ * @param a		Looked address.
+ * @return		Found symbol or null if all symbols are after the address.
+ */
+Symbol *SymbolTable::nearest(address_t a) const {
+	Symbol *s = at(a);
+	if(s != nullptr)
+		return s;
+	const Index& ind = index();
+	int i = ind.upperBound(a) - 1;
+	if(i < 0)
+		return nullptr;
+	address_t lo = ind.ents[i].lo;
+	while(i > 0 && ind.ents[i - 1].lo == lo)
+		i--;
+	return ind.ents[i].sym;
 }
 
 
@@ -196,6 +411,17 @@ cstring Segment::defaultName(Segment *seg) {
  * Get a buffer on the content of the segment.
  */
 
+/**
+ * Get a read-only buffer on the part of the segment content stored in the
+ * file. The buffer may be smaller than the segment: the remaining bytes are
+ * zero-filled in the image. This lets the image builders avoid allocating
+ * the zero-filled part. The default implementation returns buffer().
+ * @return	File part of the segment content.
+ */
+Buffer Segment::fileBuffer() {
+	return buffer();
+}
+
 
 /**
  * @class Section
@@ -236,15 +462,51 @@ Section::~Section() { }
  */
 
 
+// index of the sections sorted by name
+class File::SectionIndex {
+public:
+	typedef struct {
+		cstring name;
+		int index;
+	} entry_t;
+
+	SectionIndex(File& file) {
+		int n = file.countSections();
+		ents.setLength(n);
+		for(int i = 0; i < n; i++)
+			ents[i] = { file.sectionName(i), i };
+		if(n != 0)
+			std::sort(&ents[0], &ents[0] + n, [](const entry_t& e1, const entry_t& e2)
+				{ return e1.name < e2.name || (e1.name == e2.name && e1.index < e2.index); });
+	}
+
+	// index of the first entry whose name is not less than the given one
+	int lowerBound(cstring name) const {
+		int l = 0, h = ents.count();
+		while(l < h) {
+			int m = (l + h) / 2;
+			if(ents[m].name < name)
+				l = m + 1;
+			else
+				h = m;
+		}
+		return l;
+	}
+
+	Vector<entry_t> ents;
+};
+
+
 /**
  */
-File::File(Manager& manager, sys::Path path): man(manager), _path(path) {
+File::File(Manager& manager, sys::Path path): man(manager), _path(path), _sindex(nullptr) {
 }
 
 
 /**
  */
 File::~File(void) {
+	delete _sindex.load();
 }
 
 
@@ -297,18 +559,73 @@ Section *File::section(int i) {
 
 
 /**
- * Look for a section with the given name.
+ * Get the name of the section at index i. The default implementation
+ * gets the name from the section object but the file formats able to get
+ * the name from the section headers may override it to avoid building the
+ * section objects.
+ * @param i		Section index (between 0 and File::countSections()).
+ * @return		Section name.
+ */
+cstring File::sectionName(int i) {
+	return section(i)->name();
+}
+
+
+/**
+ * Get the index of sections by name, building it if needed.
+ * @return	Section index.
+ */
+const File::SectionIndex& File::sectionIndex() {
+	SectionIndex *i = _sindex.load(std::memory_order_acquire);
+	if(i == nullptr) {
+		std::lock_guard<std::mutex> guard(_smutex);
+		i = _sindex.load(std::memory_order_relaxed);
+		if(i == nullptr) {
+			i = new SectionIndex(*this);
+			_sindex.store(i, std::memory_order_release);
+		}
+	}
+	return *i;
+}
+
+
+/**
+ * Look for a section with the given name. The first call builds an index
+ * of the section names (see sectionName()) sorted by name: the following
+ * lookups are performed by binary search. Only the found section object
+ * is built. If several sections have the same name, the first
+ * one (in section order) is returned.
  * @param name	Name of the looked section.
  * @return		Found section or null.
  */
 Section *File::findSection(cstring name) {
-	int n = countSections();
-	for(int i = 0; i < n; i++) {
-		auto s = section(i);
-		if(s->name() == name)
-			return s;
-	}
-	return nullptr;
+	const SectionIndex& ind = sectionIndex();
+	int i = ind.lowerBound(name);
+	if(i < ind.ents.count() && ind.ents[i].name == name)
+		return section(ind.ents[i].index);
+	else
+		return nullptr;
+}
+
+
+/**
+ * Find all sections whose name starts with the given prefix, for example
+ * ".debug_" or ".text.". Uses the same index as findSection().
+ * @param prefix	Prefix of the looked sections.
+ * @return			Found sections in section order (possibly empty).
+ */
+Vector<Section *> File::findSections(cstring prefix) {
+	const SectionIndex& ind = sectionIndex();
+	Vector<SectionIndex::entry_t> found;
+	for(int i = ind.lowerBound(prefix); i < ind.ents.count() && ind.ents[i].name.startsWith(prefix); i++)
+		found.add(ind.ents[i]);
+	if(found.count() != 0)
+		std::sort(&found[0], &found[0] + found.count(),
+			[](const SectionIndex::entry_t& e1, const SectionIndex::entry_t& e2) { return e1.index < e2.index; });
+	Vector<Section *> r;
+	for(const auto& e: found)
+		r.add(section(e.index));
+	return r;
 }
 
 
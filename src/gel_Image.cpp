@@ -17,6 +17,13 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <elm/compare.h>
+#include <gel++/Exception.h>
 #include <gel++/Image.h>
 #include <iostream>
 
@@ -31,11 +38,47 @@ namespace gel {
  * Some image segment may not match any file segment if they
  * represent memory allocated by the system. For example,
  * the stack memory.
+ *
+ * The segments built from a file, or zero-filled, do not copy their content:
+ * they are split in pages of @ref page_size bytes recorded in a two-level
+ * radix table. Untouched pages point in the file content (shared in read-only
+ * mode) or, for the zero-filled part (like .bss), all alias one shared zero
+ * page. A page is copied privately only when it is written with write().
+ * The buffers returned by buffer() are read-only views: when the shared
+ * content does not cover the whole segment, or when some pages are private,
+ * the view is a contiguous copy cached until the next write and the page
+ * table is left unchanged. A contiguous private copy of the whole segment
+ * (flattening) is only built on an explicit request with writableBuffer()
+ * or clean().
+ *
+ * In any case, the pages written with write() are marked as dirty
+ * and can be listed with dirtyPages().
  */
 
+// definitions of the constants used by reference (min(), max())
+const int ImageSegment::page_bits;
+const size_t ImageSegment::page_size;
+const int ImageSegment::leaf_bits;
+const size_t ImageSegment::leaf_size;
+
+// page shared by all zero-filled pages
+alignas(ImageSegment::page_size) static const t::uint8 zero_page[ImageSegment::page_size] = { 0 };
+
+// copy a block from a shared content (zero after the end of the content)
+static void fill(const Buffer& src, offset_t off, t::uint8 *p, size_t n) {
+	size_t c = 0;
+	if(off < src.size()) {
+		c = min(n, size_t(src.size() - off));
+		std::memcpy(p, src.bytes() + off, c);
+	}
+	if(c < n)
+		std::memset(p + c, 0, n - c);
+}
+
 /**
  * Build an image segment from an allocated memory (usually
- * not coming from a file).
+ * not coming from a file). The memory is not shared: it is
+ * directly modified by the writes.
  * @param buf	Buffer containing data for the segment.
  * @param addr	Map address of the buffer.
  * @param flags	Flags of the segment (OR combination of @ref WRITABLE, @ref EXECUTABLE and @ref TO_FREE).
@@ -47,14 +90,17 @@ ImageSegment::ImageSegment(Buffer buf, address_t addr, flags_t flags, cstring na
 	_seg(0),
 	_base(addr),
 	_buf(buf),
+	_size(buf.size()),
 	_flags(flags)
 {
+	init();
 	if(!_name)
 		_name = defaultName(this);
 }
 
 /**
- * Build an image segment from a file and a buffer.
+ * Build an image segment from a file and a buffer. Unless @ref TO_FREE is
+ * set, the buffer is considered as owned by the file and is shared.
  * @param file		File containing the segment.
  * @param buf		Buffer providing content of the segment.
  * @param addr		Address in the image of the segment.
@@ -67,15 +113,44 @@ ImageSegment::ImageSegment(File *file, Buffer buf, address_t addr, flags_t flags
 		_seg(0),
 		_base(addr),
 		_buf(buf),
+		_size(buf.size()),
 		_flags(flags)
 {
+	init();
+	if(!(_flags & TO_FREE))
+		share(buf);
+	if(!_name)
+		_name = defaultName(this);
+}
+
+/**
+ * Build an image segment from a file and a buffer smaller than the segment:
+ * the buffer is shared and the remaining of the segment is zero-filled.
+ * @param file		File containing the segment.
+ * @param buf		Buffer providing the start of the segment content.
+ * @param addr		Address in the image of the segment.
+ * @param size		Size of the segment (at least the buffer size).
+ * @param flags		Flags of the segment (@ref TO_FREE is ignored).
+ * @parma name		Optional symbolic name.
+ */
+ImageSegment::ImageSegment(File *file, Buffer buf, address_t addr, size_t size, flags_t flags, cstring name)
+	:	_name(name),
+		_file(file),
+		_seg(0),
+		_base(addr),
+		_size(max(size, buf.size())),
+		_flags(flags & ~TO_FREE)
+{
+	init();
+	share(buf);
 	if(!_name)
 		_name = defaultName(this);
 }
 
 
 /**
- * Build an image segment from a file segment.
+ * Build an image segment from a file segment. The content of the file
+ * segment is shared.
  * @param file		Owner file.
  * @param segment	Segment to build image.
  * @param addr		Address to install the segment to.
@@ -86,42 +161,456 @@ ImageSegment::ImageSegment(File *file, Segment *segment, address_t addr, cstring
 	_file(file),
 	_seg(segment),
 	_base(addr),
-	_flags(TO_FREE)
+	_size(segment->size()),
+	_flags(0)
 {
+	init();
 	if(segment->isWritable())
 		_flags |= WRITABLE;
 	if(segment->isExecutable())
 		_flags |= EXECUTABLE;
-	Buffer sbuf = segment->buffer();
-	ASSERT(sbuf.bytes());
-	_buf = Buffer(sbuf.decoder(), new t::uint8[segment->size()], segment->size());
-	size_t size = 0;
+	Buffer sbuf = segment->fileBuffer();
 	if(segment->hasContent()) {
-		array::copy(_buf.bytes(), sbuf.bytes(), sbuf.size());
-		size = sbuf.size();
+		_flags |= CONTENT;
+		share(Buffer(sbuf.decoder(), sbuf.bytes(), min(sbuf.size(), _size)));
 	}
-	if(size < segment->size())
-		array::clear(_buf.bytes() + size, segment->size() - size);
+	else
+		share(Buffer(sbuf.decoder(), sbuf.bytes(), 0));
+	if(!_name)
+		_name = defaultName(this);
+}
+
+/**
+ * Build a zero-filled image segment (like a stack or a heap). No memory
+ * is allocated until the segment is written.
+ * @param decoder	Decoder for the segment content.
+ * @param addr		Address of the segment.
+ * @param size		Size of the segment.
+ * @param flags		Flags of the segment (@ref TO_FREE is ignored).
+ * @param name		Symbolic name of the segment.
+ */
+ImageSegment::ImageSegment(Decoder *decoder, address_t addr, size_t size, flags_t flags, cstring name)
+:	_name(name),
+	_file(0),
+	_seg(0),
+	_base(addr),
+	_size(size),
+	_flags(flags & ~TO_FREE)
+{
+	init();
+	share(Buffer(decoder, zero_page, 0));
 	if(!_name)
-		name = defaultName(this);
+		_name = defaultName(this);
 }
 
 /**
  */
 ImageSegment::~ImageSegment(void) {
+	for(size_t i = 0; i < leafCount(); i++)
+		release(_dir[i]);
+	delete [] _dir;
+	releaseContent();
+	dropView();
 	if(_flags & TO_FREE)
 		delete [] _buf.bytes();
 }
 
+/**
+ * Build a copy of a segment sharing its pages (used by fork()).
+ * @param s		Copied segment (must be shared).
+ */
+ImageSegment::ImageSegment(const ImageSegment& s)
+:	_name(s._name),
+	_file(s._file),
+	_seg(s._seg),
+	_base(s._base),
+	_buf(s._buf),
+	_size(s._size),
+	_flags(s._flags),
+	_shared(true),
+	_pcnt(s._pcnt),
+	_content(s._content),
+	_has_view(false)
+{
+	ASSERT(s._shared);
+	_dir = new leaf_t *[leafCount()];
+	for(size_t i = 0; i < leafCount(); i++) {
+		_dir[i] = s._dir[i];
+		if(_dir[i] != nullptr)
+			_dir[i]->refs++;
+	}
+	if(_content != nullptr)
+		_content->refs++;
+}
+
 /**
  * Clean up any link with the original file
- * (for memory save).
+ * (for memory save). As the file content may be released,
+ * a shared segment is flattened.
  */
 void ImageSegment::clean(void) {
+	flatten();
 	_file = 0;
 	_seg = 0;
 }
 
+/**
+ * Initialize the page table (for an unshared segment).
+ */
+void ImageSegment::init(void) {
+	_shared = false;
+	_pcnt = 0;
+	_content = nullptr;
+	_has_view = false;
+	_dir = new leaf_t *[leafCount()];
+	for(size_t i = 0; i < leafCount(); i++)
+		_dir[i] = nullptr;
+}
+
+/**
+ * Set up the segment to share the given content. If the content ends
+ * in the middle of a page followed by zero-filled bytes, this page
+ * is made private.
+ * @param src	Shared content.
+ */
+void ImageSegment::share(Buffer src) {
+	_buf = src;
+	_shared = true;
+	if(src.size() < _size && (src.size() & (page_size - 1)) != 0)
+		privatePage(src.size() >> page_bits);
+}
+
+/**
+ * Replace the shared content and the private pages by a contiguous
+ * private copy of the segment. Does nothing if the segment is not shared.
+ * The dirty pages are kept.
+ */
+void ImageSegment::flatten() {
+	if(!_shared)
+		return;
+	dropView();
+	t::uint8 *flat = new t::uint8[_size];
+	for(size_t i = 0; i < pageCount(); i++) {
+		offset_t off = offset_t(i) << page_bits;
+		std::memcpy(flat + off, page(i), min(page_size, size_t(_size - off)));
+	}
+	for(size_t i = 0; i < leafCount(); i++)
+		if(_dir[i] != nullptr) {
+			leaf_t *l = new leaf_t();
+			l->refs = 1;
+			for(size_t j = 0; j < leaf_size / 64; j++)
+				l->dirty[j] = _dir[i]->dirty[j];
+			release(_dir[i]);
+			_dir[i] = l;
+		}
+	releaseContent();
+	_shared = false;
+	_pcnt = 0;
+	_buf = Buffer(_buf.decoder(), flat, _size);
+	_flags |= TO_FREE;
+}
+
+/**
+ * Release the read-only view built by buffer() (if any).
+ */
+void ImageSegment::dropView() {
+	if(_has_view.load(std::memory_order_relaxed)) {
+		std::free(_view.bytes());
+		_view = Buffer();
+		_has_view.store(false, std::memory_order_relaxed);
+	}
+}
+
+/**
+ * Release a reference on a page.
+ * @param p		Released page (may be null).
+ */
+void ImageSegment::release(page_t *p) {
+	if(p != nullptr && --p->refs == 0)
+		delete p;
+}
+
+/**
+ * Release a reference on a leaf of the page table.
+ * @param l		Released leaf (may be null).
+ */
+void ImageSegment::release(leaf_t *l) {
+	if(l != nullptr && --l->refs == 0) {
+		for(size_t i = 0; i < leaf_size; i++)
+			release(l->pages[i]);
+		delete l;
+	}
+}
+
+/**
+ * Release the reference on the shared content (if it is owned by the segments).
+ */
+void ImageSegment::releaseContent() {
+	if(_content != nullptr && --_content->refs == 0) {
+		delete [] _content->bytes;
+		delete _content;
+	}
+	_content = nullptr;
+}
+
+/**
+ * Get a leaf of the page table that can be modified, building it if required
+ * or copying it if it is shared with other segments.
+ * @param i		Page index.
+ * @return		Leaf containing the page.
+ */
+ImageSegment::leaf_t *ImageSegment::leaf(size_t i) {
+	leaf_t *l = _dir[i >> leaf_bits];
+	if(l == nullptr || l->refs > 1) {
+		leaf_t *n = new leaf_t();
+		n->refs = 1;
+		if(l != nullptr) {
+			for(size_t j = 0; j < leaf_size; j++) {
+				n->pages[j] = l->pages[j];
+				if(n->pages[j] != nullptr)
+					n->pages[j]->refs++;
+			}
+			for(size_t j = 0; j < leaf_size / 64; j++)
+				n->dirty[j] = l->dirty[j];
+			release(l);
+		}
+		_dir[i >> leaf_bits] = n;
+		l = n;
+	}
+	return l;
+}
+
+/**
+ * Get the current bytes of a page of a shared segment:
+ * private copy, shared content or zero page.
+ * @param i		Page index.
+ * @return		Page bytes.
+ */
+const t::uint8 *ImageSegment::page(size_t i) const {
+	const leaf_t *l = _dir[i >> leaf_bits];
+	if(l != nullptr && l->pages[i & (leaf_size - 1)] != nullptr)
+		return l->pages[i & (leaf_size - 1)]->data;
+	offset_t off = offset_t(i) << page_bits;
+	if(off < _buf.size())
+		return _buf.bytes() + off;
+	else
+		return zero_page;
+}
+
+/**
+ * Get the private copy of a page, building it if required
+ * or copying it if it is shared with other segments.
+ * @param i		Page index.
+ * @return		Private page.
+ */
+t::uint8 *ImageSegment::privatePage(size_t i) {
+	leaf_t *l = leaf(i);
+	page_t *p = l->pages[i & (leaf_size - 1)];
+	if(p == nullptr) {
+		p = new page_t;
+		p->refs = 1;
+		fill(_buf, offset_t(i) << page_bits, p->data, page_size);
+		l->pages[i & (leaf_size - 1)] = p;
+		_pcnt++;
+	}
+	else if(p->refs > 1) {
+		page_t *n = new page_t;
+		n->refs = 1;
+		std::memcpy(n->data, p->data, page_size);
+		release(p);
+		l->pages[i & (leaf_size - 1)] = n;
+		p = n;
+	}
+	return p->data;
+}
+
+/**
+ * Build a copy-on-write fork of the segment: the fork shares the content
+ * and the pages of the segment and only copies them when they are written
+ * (by the fork or by the segment). The cost of a fork does not depend on the
+ * segment size but on the number of leaves of its page table (one per 2 MiB).
+ * An unshared segment becomes shared: its buffer is then shared by both segments
+ * (and released with the last one if it was owned).
+ *
+ * The shared pages are reference-counted: the fork and the segment may be used
+ * concurrently by different threads.
+ * @return	Forked segment.
+ */
+ImageSegment *ImageSegment::fork() {
+	if(!_shared) {
+		if(_flags & TO_FREE) {
+			_content = new content_t;
+			_content->refs = 1;
+			_content->bytes = _buf.bytes();
+			_flags &= ~TO_FREE;
+		}
+		_shared = true;
+	}
+	return new ImageSegment(*this);
+}
+
+// add a range to a list of ranges, merging it with the last one if they are contiguous
+static void addRange(Vector<range_t>& ranges, address_t a, size_t s) {
+	if(ranges.count() != 0 && ranges.top().top() == a)
+		ranges.top()._size += s;
+	else
+		ranges.add(range_t(a, s));
+}
+
+/**
+ * Compute the bytes that differ between this segment and the given one
+ * (typically, a fork of this segment). The pages still shared by both
+ * segments are not compared.
+ * @param segment	Segment to compare with (with the same base and size).
+ * @param ranges	Vector to add the differing ranges to (in increasing order).
+ */
+void ImageSegment::diff(const ImageSegment& segment, Vector<range_t>& ranges) const {
+	ASSERT(_base == segment._base && _size == segment._size);
+	bool same_content = _buf.bytes() == segment._buf.bytes() && _buf.size() == segment._buf.size();
+	for(size_t i = 0; i < pageCount(); i++) {
+		if(same_content && (i & (leaf_size - 1)) == 0
+		&& _dir[i >> leaf_bits] == segment._dir[i >> leaf_bits]) {
+			i += leaf_size - 1;
+			continue;
+		}
+		const t::uint8 *p = page(i), *q = segment.page(i);
+		offset_t off = offset_t(i) << page_bits;
+		size_t n = min(page_size, size_t(_size - off));
+		if(p == q || std::memcmp(p, q, n) == 0)
+			continue;
+		for(size_t j = 0; j < n; ) {
+			if(p[j] == q[j]) {
+				j++;
+				continue;
+			}
+			size_t k = j + 1;
+			while(k < n && p[k] != q[k])
+				k++;
+			addRange(ranges, _base + off + j, k - j);
+			j = k;
+		}
+	}
+}
+
+/**
+ * Mark as dirty the pages of a block.
+ * @param offset	Block offset.
+ * @param size		Block size.
+ */
+void ImageSegment::setDirty(offset_t offset, size_t size) {
+	if(size == 0)
+		return;
+	for(size_t i = offset >> page_bits; i <= (offset + size - 1) >> page_bits; i++)
+		leaf(i)->dirty[(i & (leaf_size - 1)) >> 6] |= t::uint64(1) << (i & 63);
+}
+
+/**
+ * Read a block of bytes from the segment.
+ * @param offset	Offset of the block in the segment.
+ * @param buf		Buffer to store the read bytes to.
+ * @param size		Size of the block.
+ */
+void ImageSegment::read(offset_t offset, void *buf, size_t size) const {
+	ASSERT(offset <= _size && size <= _size - offset);
+	t::uint8 *p = static_cast<t::uint8 *>(buf);
+	if(!_shared) {
+		std::memcpy(p, _buf.bytes() + offset, size);
+		return;
+	}
+	while(size != 0) {
+		size_t o = offset & (page_size - 1);
+		size_t n = min(size, page_size - o);
+		std::memcpy(p, page(offset >> page_bits) + o, n);
+		offset += n;
+		p += n;
+		size -= n;
+	}
+}
+
+/**
+ * Write a block of bytes in the segment. For a shared segment,
+ * only the written pages are copied. The written pages are marked
+ * as dirty. The view returned by a previous call to buffer() is released.
+ * @param offset	Offset of the block in the segment.
+ * @param buf		Buffer containing the bytes to write.
+ * @param size		Size of the block.
+ */
+void ImageSegment::write(offset_t offset, const void *buf, size_t size) {
+	ASSERT(offset <= _size && size <= _size - offset);
+	dropView();
+	setDirty(offset, size);
+	const t::uint8 *p = static_cast<const t::uint8 *>(buf);
+	if(!_shared) {
+		std::memcpy(_buf.bytes() + offset, p, size);
+		return;
+	}
+	while(size != 0) {
+		size_t o = offset & (page_size - 1);
+		size_t n = min(size, page_size - o);
+		std::memcpy(privatePage(offset >> page_bits) + o, p, n);
+		offset += n;
+		p += n;
+		size -= n;
+	}
+}
+
+/**
+ * Test if the page containing the given offset is dirty.
+ * @param offset	Offset in the segment.
+ * @return			True if the page has been written, false else.
+ */
+bool ImageSegment::isDirty(offset_t offset) const {
+	size_t i = offset >> page_bits;
+	const leaf_t *l = _dir[i >> leaf_bits];
+	return l != nullptr && (l->dirty[(i & (leaf_size - 1)) >> 6] & (t::uint64(1) << (i & 63))) != 0;
+}
+
+/**
+ * Test if the page containing the given offset is an untouched zero-filled
+ * page (that is, aliasing the shared zero page).
+ * @param offset	Offset in the segment.
+ * @return			True if the page is an untouched zero-filled page.
+ */
+bool ImageSegment::isZero(offset_t offset) const {
+	return _shared && page(offset >> page_bits) == zero_page;
+}
+
+/**
+ * Get the addresses of the dirty pages of the segment, that is,
+ * the pages written by write() since the segment creation or the last
+ * call to clearDirty(). The pages are aligned on the segment base.
+ * @return	Addresses of the dirty pages in increasing order.
+ */
+Vector<address_t> ImageSegment::dirtyPages() const {
+	Vector<address_t> r;
+	for(size_t i = 0; i < leafCount(); i++)
+		if(_dir[i] != nullptr)
+			for(size_t j = 0; j < leaf_size / 64; j++)
+				for(t::uint64 w = _dir[i]->dirty[j]; w != 0; w &= w - 1) {
+					size_t k = (i << leaf_bits) + (j << 6) + __builtin_ctzll(w);
+					r.add(_base + (address_t(k) << page_bits));
+				}
+	return r;
+}
+
+/**
+ * Mark all pages as clean. The leaves shared with forks containing dirty
+ * pages are copied first: the dirty pages of the forks are kept.
+ */
+void ImageSegment::clearDirty() {
+	for(size_t i = 0; i < leafCount(); i++)
+		if(_dir[i] != nullptr) {
+			bool dirty = false;
+			for(size_t j = 0; j < leaf_size / 64 && !dirty; j++)
+				dirty = _dir[i]->dirty[j] != 0;
+			if(!dirty)
+				continue;
+			leaf_t *l = leaf(i << leaf_bits);
+			for(size_t j = 0; j < leaf_size / 64; j++)
+				l->dirty[j] = 0;
+		}
+}
+
 ///
 cstring ImageSegment::name() { return _name; }
 
@@ -132,7 +621,7 @@ address_t ImageSegment::baseAddress() { return base(); }
 address_t ImageSegment::loadAddress() { return base(); }
 
 ///
-size_t ImageSegment::size() { return _buf.size(); }
+size_t ImageSegment::size() { return _size; }
 
 ///
 size_t ImageSegment::alignment() { return 0; }
@@ -146,8 +635,57 @@ bool ImageSegment::isWritable() { return _flags & WRITABLE; }
 ///
 bool ImageSegment::hasContent() { return _flags & CONTENT; }
 
-///
-Buffer ImageSegment::buffer() { return _buf; }
+/**
+ * Get a read-only buffer on the content of the segment (see the const form).
+ * The buffer must not be modified: use write() or writableBuffer() instead.
+ * @return	Segment buffer.
+ */
+Buffer ImageSegment::buffer() {
+	return static_cast<const ImageSegment *>(this)->buffer();
+}
+
+/**
+ * Get a read-only buffer on the content of the segment. For a shared segment
+ * whose content covers the whole segment without private page, the buffer
+ * is the shared content. Else, a contiguous view of the segment is built
+ * and kept until the next write in the segment: the page table is not
+ * modified and the zero-filled pages are not written in the view.
+ * @return	Segment buffer.
+ */
+const Buffer& ImageSegment::buffer() const {
+	if(!_shared || (_pcnt == 0 && _buf.size() >= _size))
+		return _buf;
+	if(!_has_view.load(std::memory_order_acquire)) {
+		std::lock_guard<std::mutex> guard(_view_mutex);
+		if(!_has_view.load(std::memory_order_relaxed)) {
+			t::uint8 *v = static_cast<t::uint8 *>(std::calloc(_size, 1));
+			if(v == nullptr)
+				throw std::bad_alloc();
+			for(size_t i = 0; i < pageCount(); i++) {
+				const t::uint8 *p = page(i);
+				if(p != zero_page) {
+					offset_t off = offset_t(i) << page_bits;
+					std::memcpy(v + off, p, min(page_size, size_t(_size - off)));
+				}
+			}
+			_view = Buffer(_buf.decoder(), v, _size);
+			_has_view.store(true, std::memory_order_release);
+		}
+	}
+	return _view;
+}
+
+/**
+ * Get a modifiable buffer on the content of the segment. A shared segment
+ * is first replaced by a contiguous private copy (flattening): its content
+ * is no more shared with the file or with its forks. The writes performed
+ * through this buffer are not recorded as dirty pages.
+ * @return	Modifiable segment buffer.
+ */
+Buffer ImageSegment::writableBuffer() {
+	flatten();
+	return _buf;
+}
 
 /**
  * @fn File *ImageSegment::file(void) const;
@@ -168,9 +706,15 @@ Buffer ImageSegment::buffer() { return _buf; }
  */
 
 /**
- * @fn const Buffer& ImageSegment::buffer(void) const;
- * Get the buffer to access segment data.
- * @return	Segment buffer.
+ * @fn Decoder *ImageSegment::decoder() const;
+ * Get the decoder for the content of the segment.
+ * @return	Segment decoder.
+ */
+
+/**
+ * @fn bool ImageSegment::isShared() const;
+ * Test if the segment shares its content with the file.
+ * @return	True if the segment is shared, false else.
  */
 
 /**
@@ -311,6 +855,35 @@ cstring Parameter::getenv(cstring name) const {
  */
 
 
+// identifiers of the images (never reused to keep the hints safe)
+static std::atomic<t::uint64> image_ids(1);
+
+// last segment found by Image::at() in the current thread
+typedef struct {
+	t::uint64 image;
+	ImageSegment *seg;
+} hint_t;
+static thread_local hint_t hint = { 0, nullptr };
+
+// last code shadow used by Image::code() in the current thread
+typedef struct {
+	t::uint64 image;
+	int width;
+	const void *shadow;
+} code_hint_t;
+static thread_local code_hint_t code_hint = { 0, 0, nullptr };
+
+// convert in place a table of words of 1 << w bytes
+static void decodeWords(Decoder *d, t::uint8 *p, size_t n, int w) {
+	switch(w) {
+	case 1:	d->decode(reinterpret_cast<t::uint16 *>(p), n); break;
+	case 2:	d->decode(reinterpret_cast<t::uint32 *>(p), n); break;
+	case 3:	d->decode(reinterpret_cast<t::uint64 *>(p), n); break;
+	default: break;
+	}
+}
+
+
 /**
  * @class Image
  * Image of a running program, that is a collection of code and data
@@ -318,21 +891,45 @@ cstring Parameter::getenv(cstring name) const {
  * libraries.
  *
  * An image is obtained using an @ref ImageBuilder.
+ *
+ * The segments are also recorded in a table sorted by base address
+ * so that at() is performed in logarithmic time. In addition, each thread
+ * remembers the last segment found: as the accesses of a simulator are
+ * mostly sequential, most of the look-ups are resolved without any search.
  */
 
 
 /**
  * Build an image using the given file as the program.
+ * As the segments share the content of the file, the program
+ * must remain alive as long as the image is used.
  * @param program	Program to use (it is to the user to free it).
  */
-Image::Image(File *program): _prog(program) {
+Image::Image(File *program): _prog(program), _id(image_ids++), _owns_files(true) {
+	for(int i = 0; i < shadow_widths; i++)
+		_shadows[i] = nullptr;
 	add(program);
 }
 
 /**
+ * The segments are deleted with the image, and the additional files
+ * (except for a snapshot).
  */
 Image::~Image(void) {
-	clean();
+	for(int i = 0; i < shadow_widths; i++) {
+		shadows_t *tab = _shadows[i].load();
+		if(tab != nullptr) {
+			for(const auto& sh: *tab)
+				delete [] sh.mem;
+			delete tab;
+		}
+	}
+	for(auto s: segs)
+		delete s;
+	if(_owns_files)
+		for(auto l: files())
+			if(l.file != _prog)
+				delete l.file;
 }
 
 /**
@@ -368,36 +965,384 @@ void Image::add(File *file, address_t base) {
  */
 void Image::add(ImageSegment *segment) {
 	segs.addLast(segment);
+
+	// code shadows must be rebuilt (a new identifier invalidates the thread hints)
+	if(segment->flags() & ImageSegment::EXECUTABLE) {
+		std::lock_guard<std::mutex> guard(_shadow_mutex);
+		for(int i = 0; i < shadow_widths; i++) {
+			shadows_t *tab = _shadows[i].exchange(nullptr);
+			if(tab != nullptr) {
+				for(const auto& sh: *tab)
+					delete [] sh.mem;
+				delete tab;
+			}
+		}
+		_id = image_ids++;
+	}
+
+	// insert in the sorted table (after the segments with the same base)
+	int l = 0, h = _sorted.count();
+	while(l < h) {
+		int m = (l + h) / 2;
+		if(_sorted[m]->base() <= segment->base())
+			l = m + 1;
+		else
+			h = m;
+	}
+	_sorted.insert(l, segment);
+	_tops.insert(l, 0);
+
+	// update the maximal tops from the insertion point
+	address_t top = l == 0 ? 0 : _tops[l - 1];
+	for(int i = l; i < _sorted.count(); i++) {
+		top = max(top, _sorted[i]->range().top());
+		_tops[i] = top;
+	}
+}
+
+/**
+ * Look for the index in the sorted table of the segment containing
+ * the given address. _tops[i] is the maximal top address of segments
+ * 0 to i: this allows to stop the backward scan as soon as no more segment
+ * can contain the address, even if segments overlap.
+ * @param address	Looked address.
+ * @return			Index of the segment or -1.
+ */
+int Image::lookup(address_t address) const {
+	int l = 0, h = _sorted.count();
+	while(l < h) {
+		int m = (l + h) / 2;
+		if(_sorted[m]->base() <= address)
+			l = m + 1;
+		else
+			h = m;
+	}
+	for(int i = l - 1; i >= 0 && address < _tops[i]; i--)
+		if(_sorted[i]->range().contains(address))
+			return i;
+	return -1;
 }
 
 /**
- * Find the segment at the given address.
+ * Find the segment at the given address. If several segments overlap
+ * at this address, any of them may be returned.
  * @param address	Looked address.
  * @return			Found segment or null.
  */
 ImageSegment *Image::at(address_t address) {
-	for(auto s: segments())
-		if(s->range().contains(address))
-			return s;
-	return null<ImageSegment>();
+	if(hint.image == _id && hint.seg->range().contains(address))
+		return hint.seg;
+	int i = lookup(address);
+	if(i < 0)
+		return null<ImageSegment>();
+	hint.image = _id;
+	hint.seg = _sorted[i];
+	return hint.seg;
+}
+
+/**
+ * Copy a block of bytes from or to the image. The block may straddle
+ * several contiguous segments.
+ * @param address	Address of the block.
+ * @param buf		Buffer to copy from or to.
+ * @param size		Size of the block.
+ * @param write		True to write the block in the image, false to read it.
+ * @return			Segment containing the block start.
+ * @throw Exception	If a part of the block is not mapped in the image.
+ */
+ImageSegment *Image::transfer(address_t address, void *buf, size_t size, bool write) {
+	t::uint8 *p = static_cast<t::uint8 *>(buf);
+	ImageSegment *first = at(address), *s = first;
+	while(true) {
+		if(s == nullptr)
+			throw Exception(_ << "cannot " << (write ? "write " : "read ") << size
+				<< " bytes at " << io::hex(address) << ": address not mapped");
+		offset_t off = address - s->base();
+		size_t n = min(size, size_t(s->range().size() - off));
+		if(write) {
+			s->write(off, p, n);
+			if(s->flags() & ImageSegment::EXECUTABLE)
+				updateShadows(s, off, n);
+		}
+		else
+			s->read(off, p, n);
+		size -= n;
+		if(size == 0)
+			return first;
+		address += n;
+		p += n;
+		s = at(address);
+	}
+}
+
+/**
+ * Get the code shadows for the given word width, building them if required.
+ * The shadow of an executable segment is an aligned copy of the segment
+ * content made of native words.
+ * @param w		Word width (log2 of the size in bytes).
+ * @return		Shadows of the executable segments sorted by base address.
+ */
+Image::shadows_t *Image::shadows(int w) {
+	shadows_t *tab = _shadows[w].load(std::memory_order_acquire);
+	if(tab == nullptr) {
+		std::lock_guard<std::mutex> guard(_shadow_mutex);
+		tab = _shadows[w].load(std::memory_order_relaxed);
+		if(tab == nullptr) {
+			tab = new shadows_t;
+			for(auto s: _sorted)
+				if(s->flags() & ImageSegment::EXECUTABLE) {
+					shadow_t sh;
+					sh.seg = s;
+					sh.count = s->range().size() >> w;
+					sh.mem = new t::uint8[(sh.count << w) + 63];
+					sh.words = reinterpret_cast<t::uint8 *>((reinterpret_cast<std::uintptr_t>(sh.mem) + 63) & ~std::uintptr_t(63));
+					s->read(0, sh.words, sh.count << w);
+					decodeWords(s->decoder(), sh.words, sh.count, w);
+					tab->add(sh);
+				}
+			_shadows[w].store(tab, std::memory_order_release);
+		}
+	}
+	return tab;
+}
+
+/**
+ * Update the code shadows after a write in an executable segment.
+ * @param seg		Written segment.
+ * @param offset	Offset of the written block.
+ * @param size		Size of the written block.
+ */
+void Image::updateShadows(ImageSegment *seg, offset_t offset, size_t size) {
+	if(size == 0)
+		return;
+	for(int w = 0; w < shadow_widths; w++) {
+		shadows_t *tab = _shadows[w].load(std::memory_order_acquire);
+		if(tab != nullptr)
+			for(const auto& sh: *tab)
+				if(sh.seg == seg) {
+					size_t f = offset >> w, l = min(sh.count, size_t(((offset + size - 1) >> w) + 1));
+					if(f < l) {
+						seg->read(f << w, sh.words + (f << w), (l - f) << w);
+						decodeWords(seg->decoder(), sh.words + (f << w), l - f, w);
+					}
+				}
+	}
+}
+
+/**
+ * Get a pointer on the native words of code at the given address.
+ * @param address	Address of the code (aligned on the word size relatively to the segment base).
+ * @param size		Word size (1, 2, 4 or 8).
+ * @param count		Set to the number of words available from the address to the segment end.
+ * @return			Pointer on the words.
+ * @throw Exception	If the address is not in an executable segment or is not aligned.
+ */
+const void *Image::codeAt(address_t address, int size, size_t& count) {
+	int w = size == 1 ? 0 : size == 2 ? 1 : size == 4 ? 2 : 3;
+	ASSERT(size == 1 << w);
+
+	// look in the last used shadow
+	const shadow_t *sh = nullptr;
+	if(code_hint.image == _id && code_hint.width == w) {
+		sh = static_cast<const shadow_t *>(code_hint.shadow);
+		if(address < sh->seg->base() || address - sh->seg->base() >= (sh->count << w))
+			sh = nullptr;
+	}
+
+	// look in the shadows
+	if(sh == nullptr) {
+		shadows_t *tab = shadows(w);
+		int l = 0, h = tab->count();
+		while(l < h) {
+			int m = (l + h) / 2;
+			if((*tab)[m].seg->base() <= address)
+				l = m + 1;
+			else
+				h = m;
+		}
+		if(l == 0 || address - (*tab)[l - 1].seg->base() >= ((*tab)[l - 1].count << w))
+			throw Exception(_ << "no code at " << io::hex(address));
+		sh = &(*tab)[l - 1];
+		code_hint.image = _id;
+		code_hint.width = w;
+		code_hint.shadow = sh;
+	}
+
+	// compute the result
+	offset_t off = address - sh->seg->base();
+	if((off & (size - 1)) != 0)
+		throw Exception(_ << "misaligned code fetch at " << io::hex(address));
+	count = sh->count - (off >> w);
+	return sh->words + off;
+}
+
+/**
+ * Throw an exception for a code fetch out of the segment.
+ * @param address	Fetch address.
+ * @param size		Fetch size.
+ */
+void Image::fetchError(address_t address, size_t size) {
+	throw Exception(_ << "cannot fetch " << size << " bytes of code at " << io::hex(address));
+}
+
+/**
+ * @fn const T *Image::code(address_t address, size_t& count);
+ * Get a pointer on the code at the given address as an array of native words
+ * (the address must be aligned on the word size relatively to the segment base).
+ * The words come from a shadow copy of the executable segments, aligned and
+ * converted to the host byte order once per image and word size: fetching code
+ * then performs no decoding. The shadows are kept up to date by the writes
+ * performed with Image::write(), but not by direct writes in the segments.
+ * @param address	Code address.
+ * @param count		Set to the number of words available up to the segment end.
+ * @return			Pointer on the words.
+ * @throw Exception	If the address is not in an executable segment or not aligned.
+ */
+
+/**
+ * @fn T Image::fetch(address_t address);
+ * Fetch one native word of code.
+ * @param address	Code address.
+ * @return			Fetched word.
+ * @throw Exception	If the address is not in an executable segment or not aligned.
+ */
+
+/**
+ * @fn void Image::fetch(address_t address, T *words, size_t n);
+ * Fetch a block of consecutive native words of code.
+ * @param address	Code address.
+ * @param words		Array to store the words to.
+ * @param n			Number of words.
+ * @throw Exception	If the block is not in an executable segment or not aligned.
+ */
+
+/**
+ * @fn void Image::read(address_t address, void *buf, size_t size);
+ * Read a block of bytes from the image, possibly across
+ * several contiguous segments.
+ * @param address	Address of the block.
+ * @param buf		Buffer to store the bytes to.
+ * @param size		Size of the block.
+ * @throw Exception	If a part of the block is not mapped in the image.
+ */
+
+/**
+ * @fn void Image::write(address_t address, const void *buf, size_t size);
+ * Write a block of bytes in the image, possibly across
+ * several contiguous segments. Only the written pages of shared
+ * segments are copied.
+ * @param address	Address of the block.
+ * @param buf		Buffer containing the bytes.
+ * @param size		Size of the block.
+ * @throw Exception	If a part of the block is not mapped in the image.
+ */
+
+/**
+ * @fn void Image::readN(address_t address, T *buf, size_t n);
+ * Read an array of words from the image and convert them
+ * in one pass to the native representation with the decoder
+ * of the segment containing the array start.
+ * @param address	Address of the array.
+ * @param buf		Array to store the words to.
+ * @param n			Number of words.
+ * @throw Exception	If a part of the array is not mapped in the image.
+ */
+
+/**
+ * @fn void Image::writeN(address_t address, const T *buf, size_t n);
+ * Write an array of native words in the image, converting them
+ * to the representation of the segment containing the array start.
+ * @param address	Address of the array.
+ * @param buf		Array of words to write.
+ * @param n			Number of words.
+ * @throw Exception	If a part of the array is not mapped in the image.
+ */
+
+/**
+ * Get the addresses of the dirty pages of all segments.
+ * @return	Addresses of the dirty pages in increasing order.
+ */
+Vector<address_t> Image::dirtyPages() const {
+	Vector<address_t> r;
+	for(auto s: _sorted)
+		for(auto a: s->dirtyPages())
+			r.add(a);
+	return r;
 }
 
 /**
  * Get rid of the additional files (usually dynamic libraries)
- * to save memory.
+ * to save memory. Must not be called while snapshots of the image
+ * are alive.
  */
 void Image::clean(void) {
 
+	// clean segments (before releasing the shared content)
+	for(auto s: segments())
+		if(s->file() != _prog)
+			s->clean();
+
 	// remove files
-	for(auto l: files())
-		if(l.file != _prog)
-			delete l.file;
+	if(_owns_files)
+		for(auto l: files())
+			if(l.file != _prog)
+				delete l.file;
 	_links.clear();
+}
 
-	// clean segments
+/**
+ * Build a copy-on-write snapshot of the image: each segment (including the stack)
+ * is forked and the pages are only copied when written, either in the image or in
+ * the snapshot. The cost of a snapshot does not depend on the size of the image.
+ *
+ * The files of the image are shared with the snapshot: they must not be deleted
+ * (by deleting or cleaning the image) while the snapshot is alive. Snapshots
+ * must be taken from one thread but the image and its snapshots may then be used
+ * concurrently by different threads.
+ * @return	Snapshot of the image (to delete by the caller).
+ */
+Image *Image::snapshot() {
+	Image *im = new Image(_prog);
+	im->_links.clear();
+	for(auto l: files())
+		im->_links.addLast(l);
+	im->_owns_files = false;
 	for(auto s: segments())
-		if(s->file() != _prog)
-			s->clean();
+		im->add(s->fork());
+	return im;
+}
+
+/**
+ * Compute the address ranges whose content differ between this image
+ * and the given one, typically a snapshot of this image. The segments are matched
+ * by base address and size: segments only found in one image are fully reported.
+ * @param image		Image to compare with.
+ * @return			Differing ranges (in increasing order for non-overlapping segments).
+ */
+Vector<range_t> Image::diff(const Image& image) const {
+	Vector<range_t> r;
+	int i = 0, j = 0;
+	while(i < _sorted.count() || j < image._sorted.count()) {
+		ImageSegment *s = i < _sorted.count() ? _sorted[i] : nullptr;
+		ImageSegment *t = j < image._sorted.count() ? image._sorted[j] : nullptr;
+		if(s != nullptr && t != nullptr && s->base() == t->base()) {
+			if(s->range().size() == t->range().size())
+				s->diff(*t, r);
+			else
+				addRange(r, s->base(), max(s->range().size(), t->range().size()));
+			i++;
+			j++;
+		}
+		else if(t == nullptr || (s != nullptr && s->base() < t->base())) {
+			addRange(r, s->base(), s->range().size());
+			i++;
+		}
+		else {
+			addRange(r, t->base(), t->range().size());
+			j++;
+		}
+	}
+	return r;
 }
 
 
@@ -449,6 +1394,9 @@ ImageBuilder::~ImageBuilder(void) {
  * Very simple image builder that build the memory for the given program but
  * (a) does not perform dynamic linking, (b) does not perform relocation and
  * (c) does not allocate and initialize the stack.
+ *
+ * The built image shares the content of the program file: the file
+ * must remain alive as long as the image is used.
  */
 
 /**
@@ -472,7 +1420,8 @@ Image *SimpleBuilder::build(void) {
 			// std::cout << "[gelpp/Image] WARNING: not including segment " << (const char*)seg->name() << " because of size 0." << "\n";
 			continue;
 		}
-		if(seg->buffer().bytes() == 0)
+		Buffer buf = seg->fileBuffer();
+		if(buf.bytes() == 0 && buf.size() != 0)
 		{
 			// std::cout << "[gelpp/Image] WARNING: not including segment " << (const char*)seg->name() << " because of nullptr bytes." << "\n";
 			continue;
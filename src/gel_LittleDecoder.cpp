@@ -24,21 +24,9 @@
 using namespace elm;
 
 #ifdef BIGENDIAN
-	static inline t::uint16 swap(t::uint16 x) { return (x << 8) | ((x >> 8) & 0xff); }
-	static inline t::int16 swap(t::int16 x) { return swap(t::uint16(x); }
-	static inline t::uint32 swap(t::uint32 x)
-		{ return (swap(t::uint16(x)) << 16) | swap(t::uint16(x >> 16))); }
-	static inline t::int32 swap(t::int32 x) { return swap(t::uint32(x); }
-	static inline t::uint64 swap(t::uint64 x)
-		{ return (swap(t::uint32(x)) << 32) | swap(t::uint32(x >> 32))); }
-	static inline t::int64 swap(t::int64 x) { return swap(t::uint64(x); }
+	template <class T> static inline T swap(T x) { return gel::swapBytes(x); }
 #else
-	static inline t::uint16 swap(t::uint16 x) { return x; }
-	static inline t::int16 swap(t::int16 x) { return x; }
-	static inline t::uint32 swap(t::uint32 x) { return x; }
-	static inline t::int32 swap(t::int32 x) { return x; }
-	static inline t::uint64 swap(t::uint64 x) { return x; }
-	static inline t::int64 swap(t::int64 x) { return x; }
+	template <class T> static inline T swap(T x) { return x; }
 #endif
 
 
@@ -52,6 +40,15 @@ namespace gel {
 ///
 LittleDecoder LittleDecoder::single;
 
+/**
+ * Build a little-endian decoder.
+ */
+#ifdef BIGENDIAN
+	LittleDecoder::LittleDecoder(): Decoder(SWAP) { }
+#else
+	LittleDecoder::LittleDecoder(): Decoder(NATIVE) { }
+#endif
+
 ///
 void LittleDecoder::fix(t::uint16& w) { w = swap(w); }
 
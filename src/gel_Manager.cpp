@@ -18,9 +18,11 @@
  */
 
 #include "config.h"
+#include <elm/array.h>
 #include <elm/compare.h>
 #include <elm/sys/System.h>
 #include <gel++.h>
+#include <gel++/Source.h>
 #include <gel++/elf/defs.h>
 #include <gel++/elf/File32.h>
 #include <gel++/elf/File64.h>
@@ -45,15 +47,73 @@ namespace gel {
  */
 Manager Manager::DEFAULT;
 
+/**
+ * @var Manager::MAPPED
+ * Flag passed to the open functions to ask for a memory mapping of the file
+ * (if supported by the OS and by the file format). With this flag, the content
+ * of sections and segments is not copied but directly accessed in the mapping.
+ */
+
+/**
+ * @var Manager::CONCURRENT
+ * Flag passed to the open functions to get a file that can be queried
+ * concurrently from several threads. The reads are then performed with
+ * positional reads that do not share a cursor. Only supported for ELF
+ * files (other formats are opened as usual). MAPPED files are also
+ * supporting concurrent accesses.
+ */
+
+/**
+ * @var Manager::HEADERS_ONLY
+ * Flag passed to the open functions when only the headers of the file
+ * are needed (file header, program headers, section headers and section
+ * names). These headers are then fetched with one or two big reads instead
+ * of many small ones and no content buffer is allocated to get them.
+ * Useful to scan many files. Only supported for ELF files.
+ */
+
+/**
+ * @var Manager::COMPACT_LINES
+ * Flag passed to the open functions to store the debug line information
+ * in compact form (see DebugLine): it uses 4 to 8 times less memory on
+ * binaries with huge line tables. Only supported for ELF files.
+ */
+
+/**
+ * @var Manager::LAZY_LINES
+ * Flag passed to the open functions to decode the debug line information
+ * on demand: only the headers of the line programs are read when the lines
+ * are first requested and each program is run at the first query involving
+ * its compilation unit. Useful when few lines are looked up in a big binary.
+ * Only supported for ELF files.
+ */
+
+// size of the block read at the head of files in HEADERS_ONLY mode
+static const size_t head_size = 4096;
+
 /**
  * Open an executable file. Caller is in charge of releasing
  * the obtained file.
  * @param path				Path to the file.
+ * @param flags				Open flags (MAPPED, CONCURRENT, HEADERS_ONLY, COMPACT_LINES, LAZY_LINES).
  * @return					Open file.
  * @throw gel::Exception	If there is an error.
  */
-File *Manager::openFile(sys::Path path) {
+File *Manager::openFile(sys::Path path, flags_t flags) {
 	try {
+
+		// specific source (only ELF for now)
+		Source *src = openSource(path, flags);
+		if(src != nullptr) {
+			t::uint8 magic[4];
+			if(src->size() >= sizeof(magic)) {
+				src->read(0, magic, sizeof(magic));
+				if(elf::File::matches(magic))
+					return openELFFile(path, src, flags);
+			}
+			delete src;
+		}
+
 		io::RandomAccessStream *s = sys::System::openRandomFile(path, sys::System::READ);
 
 		// read first four bytes
@@ -65,7 +125,7 @@ File *Manager::openFile(sys::Path path) {
 		
 		// is it ELF?
 		if(elf::File::matches(magic))
-			return openELFFile(path, s);
+			return openELFFile(path, new StreamSource(path, s), flags);
 
 		// is it COFF by COFFI?
 #		ifdef HAS_COFFI
@@ -92,18 +152,63 @@ File *Manager::openFile(sys::Path path) {
 }
 
 
+/**
+ * Open an executable file already loaded in memory. Caller is in charge of
+ * releasing the obtained file. The memory block is not copied: it must remain
+ * alive as long as the file is used and the content of sections points directly
+ * to it (except for COFFI that builds its own copy).
+ * @param data				Base address of the file block.
+ * @param size				Size of the file block.
+ * @param name				Name of the file (used for error messages).
+ * @return					Open file.
+ * @throw gel::Exception	If there is an error.
+ */
+File *Manager::openMemory(const void *data, size_t size, sys::Path name) {
+
+	// read first four bytes
+	t::uint8 magic[4];
+	if(size < sizeof(magic))
+		throw Exception("does not seem to be a binary!");
+	array::copy(magic, static_cast<const t::uint8 *>(data), sizeof(magic));
+
+	// is it ELF?
+	if(elf::File::matches(magic))
+		return openELFFile(name, new MemorySource(name, data, size));
+
+	// is it COFF by COFFI?
+#	ifdef HAS_COFFI
+	else if(coffi::File::matches(magic))
+		return new coffi::File(*this, name, data, size);
+#	endif
+
+	// is it PE-COFF?
+	else if(pecoff::File::matches(magic))
+		return new pecoff::File(*this, name, new MemorySource(name, data, size));
+
+	// else I don't know
+	throw Exception(_
+		<< "unknown executable format with magic: "
+		<< io::hex(magic[0])
+		<< io::hex(magic[1])
+		<< io::hex(magic[2])
+		<< io::hex(magic[3]));
+}
+
+
 /**
  * Open an ELF executable file. Caller is in charge of releasing
  * the obtained file.
  * @param path				Path to the file.
+ * @param flags				Open flags (MAPPED, CONCURRENT, HEADERS_ONLY, COMPACT_LINES, LAZY_LINES).
  * @return					Open file.
  * @throw gel::Exception	If there is an error.
  */
-elf::File *Manager::openELFFile(sys::Path path) {
-	io::RandomAccessStream *s = nullptr;
+elf::File *Manager::openELFFile(sys::Path path, flags_t flags) {
 	try {
-		s = sys::System::openRandomFile(path, sys::System::READ);
-		return openELFFile(path, s);
+		Source *src = openSource(path, flags);
+		if(src == nullptr)
+			src = new StreamSource(path, sys::System::openRandomFile(path, sys::System::READ));
+		return openELFFile(path, src, flags);
 	}
 	catch(sys::SystemException& e) {
 		throw Exception(e.message());
@@ -111,6 +216,33 @@ elf::File *Manager::openELFFile(sys::Path path) {
 }
 
 
+/**
+ * Open an ELF file from a source and apply the open flags.
+ * @param path				Path to the file.
+ * @param source			Source to read from.
+ * @param flags				Open flags.
+ * @return					Open file.
+ * @throw gel::Exception	If there is an error.
+ */
+elf::File *Manager::openELFFile(sys::Path path, Source *source, flags_t flags) {
+	elf::File *file = openELFFile(path, source);
+	if((flags & COMPACT_LINES) != 0)
+		file->setCompactLines(true);
+	if((flags & LAZY_LINES) != 0)
+		file->setLazyLines(true);
+	if((flags & HEADERS_ONLY) != 0) {
+		try {
+			file->prefetchHeaders();
+		}
+		catch(Exception&) {
+			delete file;
+			throw;
+		}
+	}
+	return file;
+}
+
+
 /**
  * Open an ELF executable file. Caller is in charge of releasing
  * the obtained file.
@@ -120,29 +252,43 @@ elf::File *Manager::openELFFile(sys::Path path) {
  * @throw gel::Exception	If there is an error.
  */
 elf::File *Manager::openELFFile(sys::Path path, io::RandomAccessStream *stream) {
+	return openELFFile(path, new StreamSource(path, stream));
+}
+
+
+/**
+ * Open an ELF executable file from a source. Caller is in charge of releasing
+ * the obtained file. The source is deleted with the file.
+ * @param path				Path to the file.
+ * @param source			Source to read from.
+ * @return					Open file.
+ * @throw gel::Exception	If there is an error.
+ */
+elf::File *Manager::openELFFile(sys::Path path, Source *source) {
+	t::uint8 buf[EI_NIDENT];
 	try {
 
 		// lookup head
-		t::uint8 buf[EI_NIDENT];
-		int bufs = stream->read(buf, sizeof(buf));
-		if(bufs < EI_NIDENT)
+		if(source->size() < EI_NIDENT)
 			throw Exception("not an ELF file");
+		source->read(0, buf, sizeof(buf));
 
 		// is it ELF?
 		if(!elf::File::matches(buf))
 			throw Exception("bad header in ELF");
-
-		// open the right ELF
-		switch(buf[EI_CLASS]) {
-		case ELFCLASS32:	return new elf::File32(*this, path, stream);
-		case ELFCLASS64:	return new elf::File64(*this, path, stream);
-		default:			throw Exception(_ << "unknown ELF class: " << io::hex(buf[EI_CLASS]));
-		}
+		if(buf[EI_CLASS] != ELFCLASS32 && buf[EI_CLASS] != ELFCLASS64)
+			throw Exception(_ << "unknown ELF class: " << io::hex(buf[EI_CLASS]));
 	}
-	catch(sys::SystemException& e) {
-		throw Exception(e.message());
+	catch(Exception&) {
+		delete source;
+		throw;
 	}
-	return nullptr;
+
+	// open the right ELF
+	if(buf[EI_CLASS] == ELFCLASS32)
+		return new elf::File32(*this, path, source);
+	else
+		return new elf::File64(*this, path, source);
 }
 
 
@@ -159,6 +305,159 @@ pecoff::File *Manager::openPECOFFFile(sys::Path path, io::RandomAccessStream *st
 }
 
 
+/**
+ * Open the source matching the given flags.
+ * @param path				Path of the file.
+ * @param flags				Open flags.
+ * @return					Built source or null if the default stream has to be used.
+ * @throw gel::Exception	If there is an error.
+ */
+Source *Manager::openSource(sys::Path path, flags_t flags) {
+	Source *src;
+	if((flags & MAPPED) != 0 && MappedSource::isSupported())
+		return new MappedSource(path);
+	else if((flags & (CONCURRENT | HEADERS_ONLY)) != 0 && FileSource::isSupported())
+		src = new FileSource(path);
+	else if((flags & HEADERS_ONLY) != 0)
+		src = new StreamSource(path, sys::System::openRandomFile(path, sys::System::READ));
+	else
+		return nullptr;
+
+	// prefetch the head for the headers
+	if((flags & HEADERS_ONLY) != 0) {
+		CachedSource *csrc = new CachedSource(src);
+		try {
+			csrc->prefetch(0, head_size);
+		}
+		catch(Exception&) {
+			delete csrc;
+			throw;
+		}
+		src = csrc;
+	}
+	return src;
+}
+
+
+/**
+ * @class Identity
+ * Summary of a binary file as returned by Manager::identify().
+ */
+
+/**
+ * @var Identity::format
+ * Format of the file (unknown_format if not recognized).
+ */
+
+/**
+ * @var Identity::address_type
+ * Size of addresses.
+ */
+
+/**
+ * @var Identity::machine
+ * Machine identifier as found in the file (e_machine for ELF, machine
+ * for PE-COFF, magic number for COFF).
+ */
+
+/**
+ * @var Identity::type
+ * Type of the file.
+ */
+
+/**
+ * @var Identity::big_endian
+ * True if the file is in big-endian, false else.
+ */
+
+///
+Identity::Identity()
+	: format(unknown_format), address_type(address_32), machine(0), type(File::no_type), big_endian(false) { }
+
+
+/**
+ * Identify the format of a binary file without opening it completely.
+ * Only a small block of the head of the file is read (plus the COFF header
+ * for PE-COFF).
+ * @param path				Path of the file.
+ * @return					Identity of the file (format is unknown_format if not recognized).
+ * @throw gel::Exception	If the file cannot be read.
+ */
+Identity Manager::identify(sys::Path path) {
+	Identity id;
+	try {
+		Source *src = openSource(path, CONCURRENT);
+		if(src == nullptr)
+			src = new StreamSource(path, sys::System::openRandomFile(path, sys::System::READ));
+		t::uint8 head[64];
+		size_t size = min(src->size(), size_t(sizeof(head)));
+		try {
+			src->read(0, head, size);
+
+			// ELF case
+			if(size >= 20 && elf::File::matches(head)) {
+				id.format = elf_format;
+				id.address_type = head[EI_CLASS] == ELFCLASS64 ? address_64 : address_32;
+				id.big_endian = head[EI_DATA] == ELFDATA2MSB;
+				t::uint16 type, machine;
+				if(id.big_endian) {
+					type = (head[16] << 8) | head[17];
+					machine = (head[18] << 8) | head[19];
+				}
+				else {
+					type = head[16] | (head[17] << 8);
+					machine = head[18] | (head[19] << 8);
+				}
+				id.machine = machine;
+				switch(type) {
+				case ET_EXEC:
+				case ET_CORE:	id.type = File::program; break;
+				case ET_DYN:	id.type = File::library; break;
+				default:		id.type = File::no_type; break;
+				}
+			}
+
+#			ifdef HAS_COFFI
+			// COFF case
+			else if(size >= 4 && coffi::File::matches(head)) {
+				id.format = coff_format;
+				id.machine = head[0] | (head[1] << 8);
+				id.type = File::program;
+			}
+#			endif
+
+			// PE-COFF case (signature offset at 0x3C, COFF header after signature)
+			else if(size >= 0x40 && pecoff::File::matches(head)) {
+				t::uint32 off = head[0x3C] | (head[0x3D] << 8) | (head[0x3E] << 16) | (t::uint32(head[0x3F]) << 24);
+				t::uint8 coff[24];
+				if(off + sizeof(coff) <= src->size()) {
+					src->read(off, coff, sizeof(coff));
+					if(coff[0] == 'P' && coff[1] == 'E' && coff[2] == 0 && coff[3] == 0) {
+						id.format = pecoff_format;
+						id.machine = coff[4] | (coff[5] << 8);
+						t::uint16 chars = coff[22] | (coff[23] << 8);
+						id.address_type = (chars & 0x0100) != 0 ? address_32 : address_16;
+						if((chars & 0x0002) != 0)
+							id.type = File::program;
+						else if((chars & 0x2000) != 0)
+							id.type = File::library;
+					}
+				}
+			}
+		}
+		catch(Exception&) {
+			delete src;
+			throw;
+		}
+		delete src;
+	}
+	catch(sys::SystemException& e) {
+		throw Exception(e.message());
+	}
+	return id;
+}
+
+
 /**
  * Format an address for output.
  * @param t	Type of address.
@@ -181,6 +480,35 @@ io::IntFormat format(address_type_t t, address_t a) {
  * Decoders are used to convert data find in executable files,
  * like integers, into data from the native environment.
  * Typically, they support  endianness conversions.
+ *
+ * As most decoders only perform byte swapping (or nothing), a decoder
+ * has a mode: NATIVE (no conversion), SWAP (byte swapping) or CUSTOM
+ * (conversion performed by the virtual fix()/unfix() functions). The
+ * decode() and encode() functions, used by Buffer and Cursor, inline
+ * the conversion for the NATIVE and SWAP modes and avoid a virtual call.
+ */
+
+/**
+ * @fn Decoder::Decoder(mode_t mode);
+ * Build a decoder.
+ * @param mode	Decoding mode (default to CUSTOM).
+ */
+
+/**
+ * @fn void Decoder::decode(T *w, size_t n);
+ * Convert in place an array of words from the file representation
+ * to the native representation. In NATIVE and SWAP modes, the loop
+ * is inlined (and can be vectorized by the compiler).
+ * @param w		Array of words.
+ * @param n		Number of words.
+ */
+
+/**
+ * @fn void Decoder::encode(T *w, size_t n);
+ * Convert in place an array of words from the native representation
+ * to the file representation.
+ * @param w		Array of words.
+ * @param n		Number of words.
  */
 
 /**
@@ -188,6 +516,33 @@ io::IntFormat format(address_type_t t, address_t a) {
 Decoder::~Decoder(void) {
 }
 
+/**
+ * @fn mode_t Decoder::mode() const;
+ * Get the decoding mode.
+ * @return	Decoding mode.
+ */
+
+/**
+ * @fn void Decoder::setMode(mode_t mode);
+ * Set the decoding mode. Subclasses call it as soon as they know
+ * the byte order of the decoded data.
+ * @param mode	New decoding mode.
+ */
+
+/**
+ * @fn void Decoder::decode(T& w);
+ * Convert w from executable representation to native representation
+ * according to the mode of the decoder.
+ * @param w	Value to convert.
+ */
+
+/**
+ * @fn void Decoder::encode(T& w);
+ * Convert w from native representation to executable representation
+ * according to the mode of the decoder.
+ * @param w	Value to convert.
+ */
+
 /**
  * @fn void Decoder::fix(t::uint16& w);
  * Called to convert w from executable endianness to native endianness.
@@ -0,0 +1,260 @@
+/*
+ * GEL++ Mirror class implementation
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include <mutex>
+#include <elm/compare.h>
+#include <gel++/Exception.h>
+#include <gel++/Mirror.h>
+
+#ifndef _WIN32
+#	include <errno.h>
+#	include <setjmp.h>
+#	include <signal.h>
+#	include <string.h>
+#	include <sys/mman.h>
+#	include <unistd.h>
+#endif
+
+namespace gel {
+
+#ifndef _WIN32
+
+// host area of a segment
+typedef struct area_t {
+	address_t lo, hi;
+	int prot;
+} area_t;
+
+// guard installed by Mirror::guard() in the current thread
+typedef struct guard_t {
+	sigjmp_buf env;
+	const Mirror *mirror;
+	address_t fault;
+	guard_t *prev;
+} guard_t;
+static thread_local guard_t *current_guard = nullptr;
+
+// previous handlers of the fault signals
+static struct sigaction old_segv, old_bus;
+static std::once_flag handlers_installed;
+
+// handler of the fault signals
+static void onFault(int sig, siginfo_t *info, void *context) {
+	guard_t *g = current_guard;
+	if(g != nullptr && g->mirror->contains(info->si_addr)) {
+		g->fault = g->mirror->target(info->si_addr);
+		siglongjmp(g->env, 1);
+	}
+
+	// not a mirror fault: give it to the previous handler
+	struct sigaction *old = sig == SIGSEGV ? &old_segv : &old_bus;
+	if(old->sa_flags & SA_SIGINFO)
+		old->sa_sigaction(sig, info, context);
+	else if(old->sa_handler != SIG_DFL && old->sa_handler != SIG_IGN)
+		old->sa_handler(sig);
+	else {
+		sigaction(sig, old, nullptr);	// faulting access will be replayed
+	}
+}
+
+static void installHandlers() {
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = onFault;
+	sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGSEGV, &sa, &old_segv);
+	sigaction(SIGBUS, &sa, &old_bus);
+}
+
+#endif
+
+
+/**
+ * @class Mirror
+ * A mirror maps the memory of an image with 32-bit addresses in a 4 GiB
+ * region of the host address space: the target address A is found at host
+ * address base() + A. Translating an address is then a simple addition,
+ * without any look-up.
+ *
+ * At build time, the whole region is reserved without access rights and
+ * the segments of the image are mapped as anonymous memory: only the pages
+ * with a content are copied, the zero-filled pages (like .bss or the stack)
+ * remain untouched and do not consume memory until they are written.
+ * Non-writable segments are mapped in read-only mode.
+ *
+ * The mirror is an independent copy of the image: the later modifications
+ * of the image are not reflected in the mirror and conversely. The words
+ * are stored in the byte order of the target.
+ *
+ * An access out of the segments or a write in a read-only segment
+ * raises a fault signal that can be turned into an error with guard().
+ * Only available on 64-bit hosts supporting mmap().
+ */
+
+/**
+ * Test if the mirror is supported on this host.
+ * @return	True if it is supported, false else.
+ */
+bool Mirror::isSupported() {
+#	ifndef _WIN32
+		return sizeof(void *) >= 8;
+#	else
+		return false;
+#	endif
+}
+
+/**
+ * Build the mirror of an image.
+ * @param image		Image to mirror (its addresses must fit in 32 bits).
+ * @throw Exception	If the mirror cannot be built.
+ */
+Mirror::Mirror(Image& image): _base(nullptr) {
+#	ifndef _WIN32
+		if(!isSupported())
+			throw Exception("cannot build a mirror: host address space too small");
+
+		// reserve the space
+		void *p = mmap(nullptr, space, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if(p == MAP_FAILED)
+			throw Exception(_ << "cannot reserve the mirror: " << strerror(errno));
+		_base = static_cast<t::uint8 *>(p);
+		address_t ps = sysconf(_SC_PAGESIZE);
+
+		try {
+
+			// collect the host areas of the segments
+			Vector<area_t> areas;
+			for(auto s: image.segments()) {
+				range_t r = s->range();
+				if(r.size() == 0)
+					continue;
+				if(r.base() >= space || r.size() > space - r.base())
+					throw Exception(_ << "cannot mirror segment " << s->name() << ": out of 32-bit space");
+				area_t a = { r.base() & ~(ps - 1), (r.top() + ps - 1) & ~(ps - 1), PROT_READ };
+				if(s->flags() & ImageSegment::WRITABLE)
+					a.prot |= PROT_WRITE;
+				areas.add(a);
+
+				// copy the pages with content
+				if(mprotect(_base + a.lo, a.hi - a.lo, PROT_READ | PROT_WRITE) < 0)
+					throw Exception(_ << "cannot map segment " << s->name() << ": " << strerror(errno));
+				for(offset_t off = 0; off < r.size(); off += ImageSegment::page_size)
+					if(!s->isZero(off))
+						s->read(off, host(r.base() + off), min(ImageSegment::page_size, size_t(r.size() - off)));
+			}
+
+			// set the protections (a host page shared by two segments gets both rights)
+			if(areas.count() != 0)
+				std::sort(&areas[0], &areas[0] + areas.count(),
+					[](const area_t& a, const area_t& b) { return a.lo < b.lo; });
+			for(int i = 0; i < areas.count(); i++)
+				if(mprotect(_base + areas[i].lo, areas[i].hi - areas[i].lo, areas[i].prot) < 0)
+					throw Exception(_ << "cannot protect the mirror: " << strerror(errno));
+			for(int i = 1; i < areas.count(); i++)
+				if(areas[i].lo < areas[i - 1].hi) {
+					address_t hi = min(areas[i].hi, areas[i - 1].hi);
+					mprotect(_base + areas[i].lo, hi - areas[i].lo, areas[i].prot | areas[i - 1].prot);
+				}
+		}
+		catch(Exception&) {
+			munmap(_base, space);
+			throw;
+		}
+#	else
+		throw Exception("cannot build a mirror: memory mapping not supported");
+#	endif
+}
+
+///
+Mirror::~Mirror() {
+#	ifndef _WIN32
+		if(_base != nullptr)
+			munmap(_base, space);
+#	endif
+}
+
+/**
+ * @fn t::uint8 *Mirror::base() const;
+ * Get the host address of the target address 0.
+ * @return	Mirror base.
+ */
+
+/**
+ * @fn t::uint8 *Mirror::host(address_t address) const;
+ * Translate a target address into a host address.
+ * @param address	Target address.
+ * @return			Host address.
+ */
+
+/**
+ * @fn address_t Mirror::target(const void *p) const;
+ * Translate a host address of the mirror into a target address.
+ * @param p		Host address.
+ * @return		Target address.
+ */
+
+/**
+ * @fn bool Mirror::contains(const void *p) const;
+ * Test if a host address is in the mirror.
+ * @param p		Host address.
+ * @return		True if the address is in the mirror, false else.
+ */
+
+/**
+ * Call a function accessing the mirror and catch the faults caused by these
+ * accesses (non-mapped address or write in a read-only segment). When a fault
+ * arises, the function is interrupted without unwinding its stack: it must not
+ * rely on destructors or hold locks at access time. The other faults are passed
+ * to the previously installed signal handlers. An exception thrown by the
+ * function is propagated to the caller.
+ * @param fun		Function to call.
+ * @param data		Data passed to the function.
+ * @param fault		Set to the faulting target address in case of fault.
+ * @return			True if the function ended normally, false in case of fault.
+ */
+bool Mirror::guard(fun_t fun, void *data, address_t& fault) {
+#	ifndef _WIN32
+		std::call_once(handlers_installed, installHandlers);
+		guard_t g;
+		g.mirror = this;
+		g.prev = current_guard;
+		if(sigsetjmp(g.env, 1) != 0) {
+			current_guard = g.prev;
+			fault = g.fault;
+			return false;
+		}
+		current_guard = &g;
+		try {
+			fun(data);
+		}
+		catch(...) {
+			current_guard = g.prev;
+			throw;
+		}
+		current_guard = g.prev;
+		return true;
+#	else
+		fun(data);
+		return true;
+#	endif
+}
+
+}	// gel
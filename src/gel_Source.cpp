@@ -0,0 +1,434 @@
+/*
+ * GEL++ Source class implementation
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstring>
+#include <limits>
+#include <elm/compare.h>
+#include <gel++/Exception.h>
+#include <gel++/Source.h>
+
+#ifndef _WIN32
+#	include <errno.h>
+#	include <fcntl.h>
+#	include <string.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace gel {
+
+// largest block read in a single system call
+static const size_t max_chunk = 1 << 30;
+
+/**
+ * @class Source
+ * A source provides the bytes of a binary file to the file readers.
+ * The reads are expressed as absolute positions in the file (no cursor
+ * is involved). Some sources are also able to provide a direct pointer
+ * to the file bytes with map(): in this case, the file readers can avoid
+ * copying the content of sections and segments. As the bytes provided by
+ * map() are read-only, the contents that may be modified by the user are
+ * obtained with mapPrivate() that only succeeds if the source can provide
+ * a private copy-on-write view of the file.
+ *
+ * All sources provided by GEL++ support concurrent calls to read() and map()
+ * from several threads.
+ */
+
+/**
+ * Build a source.
+ * @param path	Path of the source (used for error messages).
+ */
+Source::Source(sys::Path path): _path(path) {
+}
+
+///
+Source::~Source() {
+}
+
+/**
+ * @fn sys::Path Source::path() const;
+ * Get the path of the source.
+ * @return	Source path.
+ */
+
+/**
+ * @fn size_t Source::size();
+ * Get the size of the source.
+ * @return	Source size (in bytes).
+ */
+
+/**
+ * @fn void Source::read(offset_t pos, void *buf, size_t size);
+ * Read a block of bytes at the given position. Positions and sizes are 64-bit
+ * to support files bigger than 4 GiB; big blocks are read by chunks.
+ * @param pos		Position in the source.
+ * @param buf		Buffer to store read bytes in.
+ * @param size		Size of the block to read.
+ * @throw Exception	If the block cannot be read.
+ */
+
+/**
+ * Get a direct pointer on the bytes of the source. The returned bytes
+ * are read-only and remain valid until the source is deleted.
+ * @param pos	Position in the source.
+ * @param size	Size of the block.
+ * @return		Pointer on the bytes or null if the source does not support
+ * 				direct access or the block is out of bound.
+ */
+const t::uint8 *Source::map(offset_t pos, size_t size) {
+	return nullptr;
+}
+
+/**
+ * Get a direct pointer on the bytes of the source that may be modified.
+ * The modifications are private to the source (they never reach the file)
+ * and are visible to all blocks mapped from the source at the same position.
+ * The returned bytes remain valid until the source is deleted.
+ * The default implementation returns null.
+ * @param pos	Position in the source.
+ * @param size	Size of the block.
+ * @return		Pointer on the bytes or null if the source does not support
+ * 				private direct access or the block is out of bound.
+ */
+t::uint8 *Source::mapPrivate(offset_t pos, size_t size) {
+	return nullptr;
+}
+
+/**
+ * Inform the source that the given block will be read soon. The source
+ * may use this information to read the block in one operation and
+ * serve the following reads from memory. The default implementation
+ * does nothing.
+ * @param pos	Position in the source.
+ * @param size	Size of the block.
+ */
+void Source::prefetch(offset_t pos, size_t size) {
+}
+
+
+/**
+ * @class StreamSource
+ * Source reading bytes from an ELM random-access stream. As the stream
+ * has a single cursor, the reads are serialized.
+ */
+
+/**
+ * Build a stream source.
+ * @param path		Path of the file.
+ * @param stream	Stream to read from (ownership is transferred to the source).
+ */
+StreamSource::StreamSource(sys::Path path, io::RandomAccessStream *stream)
+	: Source(path), _stream(stream) { }
+
+///
+StreamSource::~StreamSource() {
+	delete _stream;
+}
+
+///
+size_t StreamSource::size() {
+	return _stream->size();
+}
+
+///
+void StreamSource::read(offset_t pos, void *buf, size_t size) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if(!_stream->moveTo(pos))
+		throw Exception(_ << "cannot move to position " << pos << " in " << path() << ": " << _stream->io::InStream::lastErrorMessage());
+	t::uint8 *p = static_cast<t::uint8 *>(buf);
+	while(size != 0) {
+		int chunk = int(min(size, max_chunk));
+		if(_stream->read(p, chunk) != chunk)
+			throw Exception(_ << "cannot read " << size << " bytes from " << path() << ": " << _stream->io::InStream::lastErrorMessage());
+		p += chunk;
+		size -= chunk;
+	}
+}
+
+
+/**
+ * @class CachedSource
+ * Source wrapping another source and keeping in memory the blocks
+ * that have been prefetched. The reads and mappings falling inside a
+ * prefetched block are served from memory: mapping such a block does not
+ * need any allocation. This is useful to coalesce the many small reads
+ * required to get the headers of a binary file.
+ */
+
+/**
+ * Build a cached source.
+ * @param source	Wrapped source (ownership is transferred to the cached source).
+ */
+CachedSource::CachedSource(Source *source): Source(source->path()), _source(source) {
+}
+
+///
+CachedSource::~CachedSource() {
+	for(const auto& b: _blocks)
+		delete [] b.data;
+	delete _source;
+}
+
+///
+size_t CachedSource::size() {
+	return _source->size();
+}
+
+///
+void CachedSource::read(offset_t pos, void *buf, size_t size) {
+	auto p = lookup(pos, size);
+	if(p != nullptr)
+		std::memcpy(buf, p, size);
+	else
+		_source->read(pos, buf, size);
+}
+
+///
+const t::uint8 *CachedSource::map(offset_t pos, size_t size) {
+	auto p = lookup(pos, size);
+	if(p != nullptr)
+		return p;
+	return _source->map(pos, size);
+}
+
+///
+t::uint8 *CachedSource::mapPrivate(offset_t pos, size_t size) {
+	return _source->mapPrivate(pos, size);
+}
+
+///
+void CachedSource::prefetch(offset_t pos, size_t size) {
+	size_t fsize = _source->size();
+	if(pos >= fsize)
+		return;
+	size = min(size, fsize - pos);
+	if(size == 0 || lookup(pos, size) != nullptr)
+		return;
+	block_t b = { pos, size, new t::uint8[size] };
+	try {
+		_source->read(pos, b.data, size);
+	}
+	catch(Exception&) {
+		delete [] b.data;
+		throw;
+	}
+	std::lock_guard<std::mutex> lock(_mutex);
+	_blocks.add(b);
+}
+
+/**
+ * Look for a prefetched block containing the given block.
+ * @param pos	Position of the block.
+ * @param size	Size of the block.
+ * @return		Pointer on the block data or null if not prefetched.
+ */
+const t::uint8 *CachedSource::lookup(offset_t pos, size_t size) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	for(const auto& b: _blocks)
+		if(b.pos <= pos && pos - b.pos <= b.size && size <= b.size - (pos - b.pos))
+			return b.data + (pos - b.pos);
+	return nullptr;
+}
+
+
+/**
+ * @class FileSource
+ * Source reading bytes from a file with positional reads (pread()). As no
+ * cursor is shared, the reads of several threads are performed in parallel.
+ * Only available on OSes supporting pread().
+ */
+
+/**
+ * Test if the file source is supported on this OS.
+ * @return	True if it is supported, false else.
+ */
+bool FileSource::isSupported() {
+#	ifndef _WIN32
+		return true;
+#	else
+		return false;
+#	endif
+}
+
+/**
+ * Build a file source.
+ * @param path		Path of the file to read.
+ * @throw Exception	If the file cannot be opened.
+ */
+FileSource::FileSource(sys::Path path): Source(path), _fd(-1), _size(0) {
+#	ifndef _WIN32
+		_fd = ::open(path.toString().asSysString(), O_RDONLY);
+		if(_fd < 0)
+			throw Exception(_ << "cannot open " << path << ": " << strerror(errno));
+		struct stat st;
+		if(fstat(_fd, &st) < 0) {
+			int err = errno;
+			::close(_fd);
+			throw Exception(_ << "cannot stat " << path << ": " << strerror(err));
+		}
+		_size = st.st_size;
+#	else
+		throw Exception(_ << "cannot open " << path << ": positional reads not supported");
+#	endif
+}
+
+///
+FileSource::~FileSource() {
+#	ifndef _WIN32
+		if(_fd >= 0)
+			::close(_fd);
+#	endif
+}
+
+///
+size_t FileSource::size() {
+	return _size;
+}
+
+///
+void FileSource::read(offset_t pos, void *buf, size_t size) {
+#	ifndef _WIN32
+		t::uint8 *p = static_cast<t::uint8 *>(buf);
+		while(size != 0) {
+			ssize_t r = ::pread(_fd, p, min(size, max_chunk), pos);
+			if(r < 0) {
+				if(errno == EINTR)
+					continue;
+				throw Exception(_ << "cannot read " << size << " bytes at " << pos << " from " << path() << ": " << strerror(errno));
+			}
+			if(r == 0)
+				throw Exception(_ << "cannot read " << size << " bytes at " << pos << " from " << path() << ": end of file");
+			p += r;
+			pos += r;
+			size -= r;
+		}
+#	endif
+}
+
+
+/**
+ * @class MemorySource
+ * Source reading bytes from a memory block provided by the caller. The block
+ * is neither copied nor released by the source: it must remain alive as long
+ * as the source (and any file opened on it) is used.
+ */
+
+/**
+ * Build a memory source.
+ * @param name	Name of the source (used for error messages).
+ * @param data	Base address of the memory block.
+ * @param size	Size of the memory block.
+ */
+MemorySource::MemorySource(sys::Path name, const void *data, size_t size)
+	: Source(name), _base(static_cast<const t::uint8 *>(data)), _size(size) { }
+
+///
+size_t MemorySource::size() {
+	return _size;
+}
+
+///
+void MemorySource::read(offset_t pos, void *buf, size_t size) {
+	auto p = map(pos, size);
+	if(p == nullptr)
+		throw Exception(_ << "cannot read " << size << " bytes at " << pos << " from " << path() << ": out of bound");
+	std::memcpy(buf, p, size);
+}
+
+///
+const t::uint8 *MemorySource::map(offset_t pos, size_t size) {
+	if(pos > _size || size > _size - pos)
+		return nullptr;
+	return _base + pos;
+}
+
+
+/**
+ * @class MappedSource
+ * Source mapping the whole file in memory in private mode. With this source,
+ * opening a file and accessing some sections only costs page faults: no copy
+ * of the content is performed. The mapping is writable but private: a page
+ * modified through mapPrivate() is copied by the OS at the first write and
+ * the file is never changed. Only available on OSes supporting mmap().
+ */
+
+/**
+ * Test if the mapped source is supported on this OS.
+ * @return	True if it is supported, false else.
+ */
+bool MappedSource::isSupported() {
+#	ifndef _WIN32
+		return true;
+#	else
+		return false;
+#	endif
+}
+
+/**
+ * Build a mapped source.
+ * @param path		Path of the file to map.
+ * @throw Exception	If the file cannot be mapped.
+ */
+MappedSource::MappedSource(sys::Path path): MemorySource(path, nullptr, 0) {
+#	ifndef _WIN32
+		int fd = ::open(path.toString().asSysString(), O_RDONLY);
+		if(fd < 0)
+			throw Exception(_ << "cannot open " << path << ": " << strerror(errno));
+		struct stat st;
+		if(fstat(fd, &st) < 0) {
+			int err = errno;
+			::close(fd);
+			throw Exception(_ << "cannot stat " << path << ": " << strerror(err));
+		}
+		_size = st.st_size;
+		if(_size > std::numeric_limits<std::size_t>::max()) {
+			::close(fd);
+			throw Exception(_ << "cannot map " << path << ": too big for the address space");
+		}
+		if(_size != 0) {
+			void *p = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			if(p == MAP_FAILED) {
+				int err = errno;
+				::close(fd);
+				throw Exception(_ << "cannot map " << path << ": " << strerror(err));
+			}
+			_base = static_cast<const t::uint8 *>(p);
+		}
+		::close(fd);
+#	else
+		throw Exception(_ << "cannot map " << path << ": memory mapping not supported");
+#	endif
+}
+
+///
+MappedSource::~MappedSource() {
+#	ifndef _WIN32
+		if(_base != nullptr)
+			munmap(const_cast<t::uint8 *>(_base), _size);
+#	endif
+}
+
+///
+t::uint8 *MappedSource::mapPrivate(offset_t pos, size_t size) {
+	return const_cast<t::uint8 *>(map(pos, size));
+}
+
+} // gel
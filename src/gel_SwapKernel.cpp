@@ -0,0 +1,196 @@
+/*
+ * GEL++ SwapKernel class implementation
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cstring>
+#include <elm/assert.h>
+#include <gel++/SwapKernel.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#	define GEL_SWAP_X86
+#	include <immintrin.h>
+#endif
+
+namespace gel {
+
+// processes blocks of period bytes with the given shuffle mask
+typedef void (*kernel_t)(t::uint8 *buf, std::size_t blocks, std::size_t period, const t::uint8 *mask);
+
+#ifdef GEL_SWAP_X86
+
+__attribute__((target("ssse3")))
+static void swapSSSE3(t::uint8 *buf, std::size_t blocks, std::size_t period, const t::uint8 *mask) {
+	for(std::size_t b = 0; b < blocks; b++, buf += period)
+		for(std::size_t i = 0; i < period; i += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + i));
+			__m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(buf + i), _mm_shuffle_epi8(v, m));
+		}
+}
+
+__attribute__((target("avx2")))
+static void swapAVX2(t::uint8 *buf, std::size_t blocks, std::size_t period, const t::uint8 *mask) {
+	for(std::size_t b = 0; b < blocks; b++, buf += period)
+		for(std::size_t i = 0; i < period; i += 32) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buf + i));
+			__m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mask + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(buf + i), _mm256_shuffle_epi8(v, m));
+		}
+}
+
+static kernel_t selectKernel(const char *& name) {
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")) {
+		name = "avx2";
+		return swapAVX2;
+	}
+	if(__builtin_cpu_supports("ssse3")) {
+		name = "ssse3";
+		return swapSSSE3;
+	}
+	name = "scalar";
+	return nullptr;
+}
+
+#else
+
+static kernel_t selectKernel(const char *& name) {
+	name = "scalar";
+	return nullptr;
+}
+
+#endif
+
+// kernel selected once for the whole process
+static const char *kernel_name = nullptr;
+static const kernel_t kernel = selectKernel(kernel_name);
+
+// swap in place a field of the given size
+static inline void swapField(t::uint8 *p, int size) {
+	switch(size) {
+	case 2: { t::uint16 x; std::memcpy(&x, p, 2); x = swapBytes(x); std::memcpy(p, &x, 2); } break;
+	case 4: { t::uint32 x; std::memcpy(&x, p, 4); x = swapBytes(x); std::memcpy(p, &x, 4); } break;
+	case 8: { t::uint64 x; std::memcpy(&x, p, 8); x = swapBytes(x); std::memcpy(p, &x, 8); } break;
+	default: break;
+	}
+}
+
+static t::uint32 gcd(t::uint32 a, t::uint32 b) {
+	while(b != 0) {
+		t::uint32 r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+
+/**
+ * @class SwapKernel
+ * Byte-swapping kernel for tables of fixed-layout records (ELF symbols,
+ * relocations, dynamic entries, program and section headers). The record
+ * layout is turned at construction into a byte permutation covering a
+ * whole number of records and of 32-byte vectors: the table is then
+ * swapped with SSSE3 or AVX2 shuffles (selected at run time according to
+ * the processor) and the remaining records with scalar code.
+ *
+ * The kernels are meant to be built once per record type and shared:
+ * apply() does not modify the kernel and may be called concurrently.
+ */
+
+/**
+ * Build a swap kernel.
+ * @param size		Size of a record (in bytes).
+ * @param fields	Fields of the record to swap (fields of 1 byte may be omitted).
+ */
+SwapKernel::SwapKernel(t::uint32 size, std::initializer_list<field_t> fields)
+	: _size(size), _period(0), _fcnt(0)
+{
+	ASSERT(fields.size() <= sizeof(_fields) / sizeof(field_t));
+	for(const auto& f: fields)
+		_fields[_fcnt++] = f;
+
+	// compute the period
+	t::uint32 period = size / gcd(size, 32) * 32;
+	if(size == 0 || period > max_period)
+		return;
+
+	// build the permutation (indexes relative to each 16-byte lane)
+	for(t::uint32 i = 0; i < period; i++)
+		_perm[i] = i % 16;
+	for(t::uint32 r = 0; r < period; r += size)
+		for(int i = 0; i < _fcnt; i++) {
+			t::uint32 o = r + _fields[i].offset;
+			t::uint32 s = _fields[i].size;
+			if(o / 16 != (o + s - 1) / 16)
+				return;		// field crossing a lane: scalar only
+			for(t::uint32 j = 0; j < s; j++)
+				_perm[o + j] = (o + s - 1 - j) % 16;
+		}
+	_period = period;
+}
+
+/**
+ * @fn t::uint32 SwapKernel::size() const;
+ * Get the size of the records handled by the kernel.
+ * @return	Record size (in bytes).
+ */
+
+/**
+ * @fn bool SwapKernel::isVector() const;
+ * Test if the kernel layout supports the vector implementation.
+ * @return	True if the vector implementation can be used.
+ */
+
+/**
+ * Swap in place a table of records. The records must be contiguous
+ * (the entry size is the record size).
+ * @param buf	Table to swap.
+ * @param n		Number of records.
+ */
+void SwapKernel::apply(t::uint8 *buf, size_t n) const {
+	if(kernel != nullptr && _period != 0) {
+		std::size_t blocks = n * _size / _period;
+		kernel(buf, blocks, _period, _perm);
+		std::size_t done = blocks * _period / _size;
+		buf += done * _size;
+		n -= done;
+	}
+	applyScalar(buf, n);
+}
+
+/**
+ * Swap in place a table of records with the scalar implementation.
+ * @param buf	Table to swap.
+ * @param n		Number of records.
+ */
+void SwapKernel::applyScalar(t::uint8 *buf, size_t n) const {
+	for(size_t r = 0; r < n; r++, buf += _size)
+		for(int i = 0; i < _fcnt; i++)
+			swapField(buf + _fields[i].offset, _fields[i].size);
+}
+
+/**
+ * Get the name of the swap implementation selected for this processor.
+ * @return	"avx2", "ssse3" or "scalar".
+ */
+const char *SwapKernel::implementation() {
+	return kernel_name;
+}
+
+}	// gel
@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <cstring>
+#include <elm/compare.h>
 #include <elm/io/RandomAccessStream.h>
 #include <elm/sys/System.h>
 
@@ -226,7 +228,7 @@ static inline void swap(t::uint64& swap) {
 		swap =	((swap & 0x00000000000000ffULL) << 56)
 			 |	((swap & 0x000000000000ff00ULL) << 40)
 			 |	((swap & 0x0000000000ff0000ULL) << 16)
-			 |	((swap & 0x00000000ff000000ULL) << 8);
+			 |	((swap & 0x00000000ff000000ULL) << 8)
 			 |  ((swap & 0x000000ff00000000ULL) >> 8)
 			 |	((swap & 0x0000ff0000000000ULL) >> 16)
 			 |	((swap & 0x00ff000000000000ULL) >> 40)
@@ -299,14 +301,33 @@ bool File::matches(t::uint8 magic[4]) {
  * @param path		Path of the file to open.
  * @throw Exception	If there is a format error.
  */
-File::File(Manager& manager, sys::Path path, io::RandomAccessStream *stream_):
+File::File(Manager& manager, sys::Path path, io::RandomAccessStream *stream):
+	File(manager, path, new StreamSource(path, stream))
+{
+}
+
+/**
+ * Open the given PE-COFF file from a source.
+ * @param manager	Current GEL manager.
+ * @param path		Path of the file to open.
+ * @param source	Source to read from (ownership is transferred to the file).
+ * @throw Exception	If there is a format error.
+ */
+File::File(Manager& manager, sys::Path path, Source *source):
 	gel::File(manager, path),
-	stream(stream_),
+#	ifdef ENDIANNESS_BIG
+		Decoder(SWAP),
+#	else
+		Decoder(NATIVE),
+#	endif
+	src(source),
+	pos(0),
 	_data_directories(nullptr),
 	_section_table(nullptr),
 	_symbol_table(nullptr),
 	_string_table(nullptr),
-	_string_table_size(0)
+	_string_table_size(0),
+	_symtab(nullptr)
 {
 	try {
 
@@ -378,7 +399,7 @@ File::File(Manager& manager, sys::Path path, io::RandomAccessStream *stream_):
 
 		// read windows specific field
 		if(_standard_coff_fields.magic == PE32P) {
-			stream->moveBackward(sizeof(t::uint32));
+			pos -= sizeof(t::uint32);
 			read(
 				&_windows_specific_fields,
 				sizeof(_windows_specific_fields));
@@ -506,8 +527,8 @@ File::File(Manager& manager, sys::Path path, io::RandomAccessStream *stream_):
 
 ///
 File::~File() {
-	if(stream != nullptr)
-		delete stream;
+	if(src != nullptr)
+		delete src;
 	if(_data_directories != nullptr)
 		delete [] _data_directories;
 	if(_section_table != nullptr)
@@ -516,6 +537,8 @@ File::~File() {
 		delete [] _symbol_table;
 	if(_string_table != nullptr)
 		delete [] _string_table;
+	if(_symtab != nullptr)
+		delete _symtab;
 	deleteAll(sects);
 }
 
@@ -612,22 +635,22 @@ void File::raise(const string& msg) {
  * @param len		Length of the buffer.
  */
 void File::read(void *buf, int len) {
-	int r = stream->read(buf, len);
-	if(r < 0)
-		raise(_ << "IO error: " << stream->io::InStream::lastErrorMessage());
-	else if(r != len)
-		raise(_ << "format error, requested " << len << " bytes, got " << r << " bytes");
+	if(pos + len > src->size())
+		raise(_ << "format error, requested " << len << " bytes at " << pos << ", out of file");
+	src->read(pos, buf, len);
+	pos += len;
 }
 
 
 /**
- * Move the stream to the given location.
+ * Move the read position to the given location.
  * @param offset	Absolute offset in the file.
- * @throw Exception	If there is an IO error.
+ * @throw Exception	If the offset is out of the file.
  */
 void File::move(offset_t offset) {
-	if(!stream->moveTo(offset))
-		throw Exception(_ << "IO error: " << stream->io::InStream::lastErrorMessage());
+	if(offset > src->size())
+		throw Exception(_ << "IO error: offset " << offset << " out of file");
+	pos = offset;
 }
 
 
@@ -670,13 +693,121 @@ Segment *File::segment(int i) {
 }
 
 ///
-Image *File::make(const Parameter& params) {
-	return nullptr;
+int File::countSections() {
+	return sects.count();
 }
 
 ///
-const SymbolTable& File::symbols() {
+gel::Section *File::section(int i) {
+	return sects[i];
+}
+
+///
+Image *File::make(const Parameter& params) {
+	return nullptr;
+}
 
+/**
+ * Get the symbols of the COFF symbol table. Their value is the relative
+ * virtual address of the symbol (as the section base addresses) and
+ * their size is only known for function definitions. Executable images
+ * have usually no symbol table: the table is then empty.
+ * @return	Symbol table.
+ */
+const gel::SymbolTable& File::symbols() {
+	if(_symtab == nullptr) {
+		_symtab = new SymbolTable();
+		t::uint32 n = _coff_header.number_of_symbols;
+		if(_coff_header.pointer_to_symbol_table == 0 || n == 0)
+			return *_symtab;
+
+		// read the raw table (records are 18 bytes long)
+		const int rec_size = 18;
+		if(t::uint64(n) * rec_size > src->size())
+			raise(_ << "format error, symbol table out of file");
+		t::uint8 *buf = new t::uint8[size_t(n) * rec_size];
+		try {
+			move(_coff_header.pointer_to_symbol_table);
+			read(buf, n * rec_size);
+
+			// build the symbols
+			for(t::uint32 i = 0; i < n; i++) {
+				const t::uint8 *r = buf + i * rec_size;
+				t::uint32 value, zeroes, offset;
+				t::uint16 secnum, type;
+				std::memcpy(&zeroes, r, sizeof(zeroes));
+				std::memcpy(&offset, r + 4, sizeof(offset));
+				std::memcpy(&value, r + 8, sizeof(value));
+				std::memcpy(&secnum, r + 12, sizeof(secnum));
+				std::memcpy(&type, r + 14, sizeof(type));
+				t::uint8 sclass = r[16], naux = r[17];
+				swap(zeroes);
+				swap(offset);
+				swap(value);
+				swap(secnum);
+				swap(type);
+
+				// only keep symbols defined in a section
+				if(secnum >= 1 && secnum <= sects.count()
+				&& (sclass == IMAGE_SYM_CLASS_EXTERNAL || sclass == IMAGE_SYM_CLASS_STATIC
+				 || sclass == IMAGE_SYM_CLASS_LABEL || sclass == IMAGE_SYM_CLASS_WEAK_EXTERNAL)) {
+
+					// get the name
+					string name;
+					if(zeroes != 0) {
+						const char *p = reinterpret_cast<const char *>(r);
+						int l = 0;
+						while(l < 8 && p[l] != '\0')
+							l++;
+						name = string(p, l);
+					}
+					else if(offset >= 4) {
+						getString(offset);
+						if(offset - 4 < _string_table_size)
+							name = _string_table + offset - 4;
+					}
+
+					// get the properties
+					Section *sect = sects[secnum - 1];
+					Symbol::type_t stype;
+					t::uint32 ssize = 0;
+					if(sclass == IMAGE_SYM_CLASS_LABEL)
+						stype = Symbol::LABEL;
+					else if(((type >> 4) & 0x3) == IMAGE_SYM_DTYPE_FUNCTION) {
+						stype = Symbol::FUNC;
+						if(naux >= 1 && i + 1 < n) {
+							std::memcpy(&ssize, r + rec_size + 4, sizeof(ssize));
+							swap(ssize);
+						}
+					}
+					else if(value == 0 && sclass == IMAGE_SYM_CLASS_STATIC && naux != 0)
+						stype = Symbol::OTHER_TYPE;		// section symbol
+					else if((sect->flags() & IS_EXECUTABLE) != 0)
+						stype = Symbol::NO_TYPE;
+					else
+						stype = Symbol::DATA;
+					Symbol::bind_t bind;
+					switch(sclass) {
+					case IMAGE_SYM_CLASS_EXTERNAL:		bind = Symbol::GLOBAL; break;
+					case IMAGE_SYM_CLASS_WEAK_EXTERNAL:	bind = Symbol::WEAK; break;
+					default:							bind = Symbol::LOCAL; break;
+					}
+
+					auto sym = new Symbol(name, sect->baseAddress() + value, ssize, stype, bind);
+					_symtab->add(sym);
+				}
+
+				// skip auxiliary records
+				i += naux;
+			}
+		}
+		catch(Exception&) {
+			delete [] buf;
+			throw;
+		}
+		delete [] buf;
+	}
+	return *_symtab;
 }
 
 /**
@@ -686,7 +817,7 @@ const SymbolTable& File::symbols() {
 cstring File::getString(t::uint32 offset) {
 	if(_string_table == nullptr) {
 		// symbol_t is not padded! Size is 18 and not 20!
-		stream->moveTo(_coff_header.pointer_to_symbol_table + 18 * _coff_header.number_of_symbols);
+		move(_coff_header.pointer_to_symbol_table + 18 * _coff_header.number_of_symbols);
 		read(&_string_table_size, sizeof(_string_table_size));
 		swap(_string_table_size);
 		_string_table_size -= 4;
@@ -713,6 +844,94 @@ void File::unfix(t::uint64& w) { fix(w); }
 void File::unfix(t::int64& w) { fix(w); }
 
 
+/**
+ * @class SymbolTable
+ * Symbol table of a PE-COFF file. The table owns all its symbols, including
+ * the ones sharing the same name (static symbols of several objects,
+ * section symbols, etc): the map associates each name with the preferred
+ * symbol (global, then weak, then local; the first one for a same binding)
+ * but all symbols are considered by the address lookups.
+ * @ingroup pecoff
+ */
+
+///
+SymbolTable::~SymbolTable() {
+	for(auto s: _syms)
+		delete s;
+}
+
+// rank of a binding when several symbols have the same name
+static int bindRank(Symbol::bind_t bind) {
+	switch(bind) {
+	case Symbol::GLOBAL:	return 3;
+	case Symbol::WEAK:		return 2;
+	case Symbol::LOCAL:		return 1;
+	default:				return 0;
+	}
+}
+
+/**
+ * Add a symbol to the table that becomes its owner.
+ * @param sym	Added symbol.
+ */
+void SymbolTable::add(Symbol *sym) {
+	_syms.add(sym);
+	gel::Symbol *old = get(sym->name(), nullptr);
+	if(old == nullptr || bindRank(sym->bind()) > bindRank(old->bind()))
+		put(sym->name(), sym);
+}
+
+///
+void SymbolTable::collect(Vector<gel::Symbol *>& syms) const {
+	for(auto s: _syms)
+		syms.add(s);
+}
+
+
+/**
+ * @class Symbol
+ * Symbol of the COFF symbol table of a PE-COFF file.
+ * @ingroup pecoff
+ */
+
+/**
+ * Build a symbol.
+ * @param name	Symbol name.
+ * @param value	Symbol value (relative virtual address).
+ * @param size	Symbol size (0 if unknown).
+ * @param type	Symbol type.
+ * @param bind	Symbol binding.
+ */
+Symbol::Symbol(string name, t::uint64 value, t::uint64 size, type_t type, bind_t bind):
+	_name(name), _value(value), _size(size), _type(type), _bind(bind)
+	{ }
+
+///
+cstring Symbol::name() {
+	return _name.toCString();
+}
+
+///
+t::uint64 Symbol::value() {
+	return _value;
+}
+
+///
+t::uint64 Symbol::size() {
+	return _size;
+}
+
+///
+Symbol::type_t Symbol::type() {
+	return _type;
+}
+
+///
+Symbol::bind_t Symbol::bind() {
+	return _bind;
+}
+
+
 /**
  * @class Section
  * Segment from the GEL++ portable interface corresponds to sections of the
@@ -722,12 +941,12 @@ void File::unfix(t::int64& w) { fix(w); }
 
 ///
 Section::Section(File *file, const section_header_t *header):
-	hd(header), pec(file), _buf(nullptr), _flags(-1)
+	hd(header), pec(file), _buf(nullptr), _own(true), _flags(-1)
 	{ }
 
 ///
 Section::~Section() {
-	if(_buf != nullptr)
+	if(_buf != nullptr && _own)
 		delete [] _buf;
 }
 
@@ -792,19 +1011,32 @@ bool Section::hasContent(void) {
 ///
 Buffer Section::buffer(void) {
 	if(_buf == nullptr) {
+
+		// raw data covering the whole section: use it directly if possible
+		if(hd->size_of_raw_data >= hd->virtual_size) {
+			_buf = const_cast<t::uint8 *>(pec->src->map(hd->pointer_to_raw_data, hd->virtual_size));
+			if(_buf != nullptr) {
+				_own = false;
+				return Buffer(pec, _buf, hd->virtual_size);
+			}
+		}
+
+		// else build a copy
 		_buf = new t::uint8[hd->virtual_size];
-		if(hd->size_of_raw_data != 0) {
-			if(!pec->stream->moveTo(hd->pointer_to_raw_data)) {
+		t::uint32 size = min(hd->size_of_raw_data, hd->virtual_size);
+		if(size != 0) {
+			try {
+				pec->move(hd->pointer_to_raw_data);
+				pec->read(_buf, size);
+			}
+			catch(Exception&) {
 				delete [] _buf;
 				_buf = nullptr;
 				pec->raise(_ << "bad pointer_to_raw_data for section " << name());
 			}
-			pec->read(_buf, hd->size_of_raw_data);
 		}
-		if(hd->size_of_raw_data < hd->virtual_size)
-			array::clear(
-				_buf + hd->virtual_size,
-				hd->virtual_size - hd->size_of_raw_data);
+		if(size < hd->virtual_size)
+			array::clear(_buf + size, hd->virtual_size - size);
 	}
 	return Buffer(pec, _buf, hd->virtual_size);
 }
@@ -0,0 +1,95 @@
+/*
+ * GEL++ test helpers
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef GELPP_TEST_CHECK_H_
+#define GELPP_TEST_CHECK_H_
+
+#include <algorithm>
+#include <elm/io.h>
+#include <elm/data/Vector.h>
+#include <gel++/DebugLine.h>
+
+// number of failed checks
+static int failed = 0;
+
+// record a failed check
+#define CHECK(c) \
+	do { \
+		if(!(c)) { \
+			elm::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #c << elm::io::endl; \
+			failed++; \
+		} \
+	} while(0)
+
+// result of the test program
+#define RESULT \
+	(elm::cout << (failed == 0 ? "OK" : "FAILED") << elm::io::endl, failed == 0 ? 0 : 1)
+
+// test if two line rows (possibly of different DebugLine objects) are equal
+static inline bool sameLine(const gel::DebugLine::LineNumber& l1, const gel::DebugLine::LineNumber& l2) {
+	return l1.addr() == l2.addr()
+		&& l1.file()->path() == l2.file()->path()
+		&& l1.line() == l2.line()
+		&& l1.col() == l2.col()
+		&& l1.flags() == l2.flags()
+		&& l1.isa() == l2.isa()
+		&& l1.discriminator() == l2.discriminator()
+		&& l1.op_index() == l2.op_index();
+}
+
+// maximum number of looked addresses
+static const int max_lookups = 2000;
+
+// code of a row, as found by a plain scan of the line tables
+typedef struct {
+	gel::address_t lo, hi;
+	const gel::DebugLine::LineNumber *line;
+	bool alone;		// true if the code does not overlap the one of another row
+} interval_t;
+
+// collect, sorted by address, the code of the rows of a (not compact) debug
+// line, marking the ones not overlapping others, and the ends of sequences
+static inline void collectRows(const gel::DebugLine& dl, elm::Vector<interval_t>& ints,
+elm::Vector<gel::address_t> *ends = nullptr) {
+	typedef gel::DebugLine::LineNumber LineNumber;
+	for(auto cu: dl.units()) {
+		const auto& lines = cu->lines();
+		for(int i = 0; i < lines.count(); i++)
+			if(lines[i].flags() & LineNumber::END_SEQUENCE) {
+				if(ends != nullptr)
+					ends->add(lines[i].addr());
+			}
+			else if(i + 1 < lines.count() && lines[i].addr() < lines[i + 1].addr())
+				ints.add({ lines[i].addr(), lines[i + 1].addr(), &lines[i], true });
+	}
+	if(ints.count() == 0)
+		return;
+	std::sort(&ints[0], &ints[0] + ints.count(),
+		[](const interval_t& a, const interval_t& b) { return a.lo < b.lo; });
+	gel::address_t top = ints[0].hi;
+	for(int i = 1; i < ints.count(); i++) {
+		if(ints[i].lo < top) {
+			ints[i].alone = false;
+			for(int j = i - 1; j >= 0 && ints[j].hi > ints[i].lo; j--)
+				ints[j].alone = false;
+		}
+		top = elm::max(top, ints[i].hi);
+	}
+}
+
+#endif	// GELPP_TEST_CHECK_H_
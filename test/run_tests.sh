@@ -5,3 +5,12 @@ cd ${0%/*} # Move to script path
 ../bin/gel-file simple_ti_TMS320C28.obj
 ../bin/gel-sect simple_ti_TMS320C28.obj
 ../bin/gel-seg  simple_ti_TMS320C28.obj
+
+../bin/gel-line -s ../src/libgel++.so
+../bin/gel-line -m -s ../src/libgel++.so
+
+for t in ./test-*; do
+	if [ -x "$t" ]; then
+		$t ../src/libgel++.so
+	fi
+done
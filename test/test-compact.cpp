@@ -0,0 +1,173 @@
+/*
+ * Check of CompactLineTable
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <memory>
+#include <gel++.h>
+#include <gel++/CompactLineTable.h>
+#include "check.h"
+
+using namespace elm;
+using namespace gel;
+
+typedef DebugLine::LineNumber LineNumber;
+
+// test if a call raises a gel::Exception
+template <class F>
+static bool fails(F f) {
+	try {
+		f();
+	}
+	catch(gel::Exception&) {
+		return true;
+	}
+	return false;
+}
+
+// add a sequence of n rows at the given address
+static void sequence(Vector<LineNumber>& rows, address_t addr, int n, DebugLine::File **files, bool end = true) {
+	for(int i = 0; i < n; i++) {
+		t::uint32 flags = i % 3 == 0 ? LineNumber::IS_STMT : 0;
+		if(i == n - 1 && end)
+			flags |= LineNumber::END_SEQUENCE;
+		rows.add(LineNumber(addr, files[(i / 7) % 3], 10 + (i * 37) % 50 - 20 * (i % 2),
+			i % 5, flags, i % 11 == 0 ? 1 : 0, i % 13 == 0 ? 2 : 0, 0));
+		addr += 1 + (i * 7) % 40;
+	}
+}
+
+// check the round trip of some rows through the table
+static void roundTrip() {
+	DebugLine::File f1("a.c"), f2("b.c"), f3("c.h");
+	DebugLine::File *files[] = { &f1, &f2, &f3 };
+
+	// sequences out of order, with a single row one and an unterminated one
+	Vector<LineNumber> a, b, c, d, rows;
+	sequence(a, 0x30000, 50, files);
+	sequence(b, 0x10000, 300, files);
+	sequence(c, 0x20000, 1, files);
+	sequence(d, 0x40000, 20, files, false);
+	for(auto s: { &a, &b, &c, &d })
+		for(const auto& l: *s)
+			rows.add(l);
+
+	// expected order: by address, without the single row sequence, all terminated
+	Vector<LineNumber> exp;
+	for(auto s: { &b, &a, &d })
+		for(const auto& l: *s)
+			exp.add(l);
+	const LineNumber& last = exp[exp.count() - 1];
+	exp[exp.count() - 1] = LineNumber(last.addr(), last.file(), last.line(), last.col(),
+		last.flags() | LineNumber::END_SEQUENCE, last.isa(), last.discriminator(), last.op_index());
+
+	CompactLineTable tab;
+	CompactLineTable::Builder builder(tab);
+	for(const auto& l: rows)
+		builder.add(l);
+	builder.finish();
+
+	// iteration and random access
+	CHECK(tab.count() == exp.count());
+	int n = 0;
+	for(CompactLineTable::Iter i(tab); !i.ended(); i.next()) {
+		CHECK(n < exp.count() && sameLine(i.item(), exp[n]) && i.item().file() == exp[n].file());
+		n++;
+	}
+	CHECK(n == exp.count());
+	for(int i = 0; i < tab.count() && i < exp.count(); i++)
+		CHECK(sameLine(tab[i], exp[i]));
+
+	// lookups
+	for(int i = 0; i + 1 < exp.count(); i++)
+		if(!(exp[i].flags() & LineNumber::END_SEQUENCE)) {
+			LineNumber r;
+			CHECK(tab.lineAt(exp[i].addr(), r) && sameLine(r, exp[i]));
+			CHECK(tab.lineAt(exp[i + 1].addr() - 1, r) && sameLine(r, exp[i]));
+		}
+		else {
+			LineNumber r;
+			CHECK(!tab.lineAt(exp[i].addr(), r));
+		}
+	LineNumber r;
+	CHECK(!tab.lineAt(0x20000, r));
+	CHECK(!tab.lineAt(0x100, r));
+}
+
+// compare the lookups of the lines of a file in normal and compact forms
+static void compare(sys::Path path) {
+	std::unique_ptr<gel::File> f(Manager::open(path));
+	std::unique_ptr<gel::File> cf(Manager::open(path, Manager::COMPACT_LINES));
+	auto dl = f->debugLines(), cdl = cf->debugLines();
+	CHECK(dl != nullptr && cdl != nullptr);
+	if(dl == nullptr || cdl == nullptr)
+		return;
+	CHECK(!dl->isCompact() && cdl->isCompact());
+
+	// collect the code of the rows, marking the ones not overlapping others
+	Vector<interval_t> ints;
+	collectRows(*dl, ints);
+	CHECK(ints.count() != 0);
+	if(ints.count() == 0)
+		return;
+
+	// the same rows are found
+	int step = max(1, ints.count() / max_lookups);
+	for(int i = 0; i < ints.count(); i += step)
+		for(address_t a: { ints[i].lo, ints[i].hi - 1 }) {
+			LineNumber l, cl;
+			bool found = dl->lineAt(a, l), cfound = cdl->lineAt(a, cl);
+			CHECK(found && cfound);
+			if(ints[i].alone && found && cfound)
+				CHECK(sameLine(l, cl));
+		}
+
+	// the compact form uses less memory
+	size_t rows = 0, size = 0;
+	for(auto cu: cdl->units()) {
+		auto compact = cu->compactLines();
+		CHECK(compact != nullptr);
+		if(compact != nullptr) {
+			rows += compact->count();
+			size += compact->footprint();
+		}
+	}
+	CHECK(rows != 0);
+	CHECK(size * 2 <= rows * sizeof(LineNumber));
+
+	// the accessors to stored LineNumber fail in compact mode
+	CHECK(fails([&]() { cdl->units()[0]->lines(); }));
+	CHECK(fails([&]() { cdl->units()[0]->lineAt(ints[0].lo); }));
+	CHECK(fails([&]() { cdl->lineAt(ints[0].lo); }));
+	CHECK(fails([&]() { cdl->linesIn(ints[0].lo, ints[0].hi); }));
+}
+
+int main(int argc, char **argv) {
+	if(argc != 2) {
+		cerr << "ERROR: syntax: test-compact <ELF file with debug information>\n";
+		return 2;
+	}
+	try {
+		roundTrip();
+		compare(argv[1]);
+	}
+	catch(gel::Exception& e) {
+		cerr << "ERROR: " << e.message() << io::endl;
+		return 2;
+	}
+	return RESULT;
+}
@@ -0,0 +1,94 @@
+/*
+ * Check of File::lookupDynamic()
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <memory>
+#include <thread>
+#include <vector>
+#include <gel++.h>
+#include <gel++/elf/File.h>
+#include "check.h"
+
+using namespace elm;
+using namespace gel;
+
+// number of concurrent looking threads
+static const int thread_count = 4;
+
+int main(int argc, char **argv) {
+	if(argc != 2) {
+		cerr << "ERROR: syntax: test-dynsym <ELF shared object>\n";
+		return 2;
+	}
+	try {
+		std::unique_ptr<elf::File> f(Manager::openELF(argv[1]));
+
+		// get the defined dynamic symbols
+		elf::Section *sect = nullptr;
+		for(auto s: f->sections())
+			if(s->type() == SHT_DYNSYM)
+				sect = s;
+		CHECK(sect != nullptr);
+		if(sect == nullptr)
+			return RESULT;
+		elf::SymbolTable dynsyms;
+		f->fillSymbolTable(dynsyms, sect);
+		Vector<elf::Symbol *> defs;
+		for(auto s: dynsyms) {
+			auto es = static_cast<elf::Symbol *>(s);
+			if(es->shndx() != SHN_UNDEF && es->elfBind() != STB_LOCAL)
+				defs.add(es);
+		}
+		CHECK(defs.count() != 0);
+
+		// concurrent lookups
+		std::vector<std::vector<elf::Symbol *> > found(thread_count);
+		std::vector<std::thread> threads;
+		for(int t = 0; t < thread_count; t++)
+			threads.push_back(std::thread([&, t]() {
+				for(int i = 0; i < defs.count(); i++)
+					found[t].push_back(f->lookupDynamic(defs[(i * (t + 1)) % defs.count()]->name()));
+			}));
+		for(auto& t: threads)
+			t.join();
+
+		// the hash tables find the defined symbols with the same value
+		for(auto s: defs) {
+			auto r = f->lookupDynamic(s->name());
+			CHECK(r != nullptr && r->value() == s->value() && r->size() == s->size());
+		}
+		auto r = f->lookupDynamic("_ZN3gel7Manager7DEFAULTE");
+		CHECK(r != nullptr);
+		if(r != nullptr && f->symbols().hasKey(r->name()))
+			CHECK(f->symbols().get(r->name(), nullptr)->value() == r->value());
+
+		// missing names are found (and cached) as missing
+		CHECK(f->lookupDynamic("__gel_test_missing_symbol__") == nullptr);
+		CHECK(f->lookupDynamic("__gel_test_missing_symbol__") == nullptr);
+
+		// the concurrent lookups gave the recorded symbols
+		for(int t = 0; t < thread_count; t++)
+			for(int i = 0; i < defs.count(); i++)
+				CHECK(found[t][i] == f->lookupDynamic(defs[(i * (t + 1)) % defs.count()]->name()));
+	}
+	catch(gel::Exception& e) {
+		cerr << "ERROR: " << e.message() << io::endl;
+		return 2;
+	}
+	return RESULT;
+}
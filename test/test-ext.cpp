@@ -0,0 +1,112 @@
+/*
+ * Check of the ELF64 extended section numbering
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include <gel++.h>
+#include <gel++/elf/File.h>
+#include "check.h"
+
+using namespace elm;
+using namespace gel;
+
+// offsets in the ELF64 header and section header
+static const int
+	EI_DATA_OFF = 5,
+	E_SHOFF_OFF = 40,
+	E_SHNUM_OFF = 60,
+	E_SHSTRNDX_OFF = 62,
+	SH_SIZE_OFF = 32,
+	SH_LINK_OFF = 40;
+
+// read an integer in the file byte order
+static t::uint64 get(const std::vector<t::uint8>& d, int off, int size, bool big) {
+	t::uint64 v = 0;
+	for(int i = 0; i < size; i++)
+		v |= t::uint64(d[off + (big ? size - 1 - i : i)]) << (8 * i);
+	return v;
+}
+
+// write an integer in the file byte order
+static void put(std::vector<t::uint8>& d, int off, int size, bool big, t::uint64 v) {
+	for(int i = 0; i < size; i++)
+		d[off + (big ? size - 1 - i : i)] = t::uint8(v >> (8 * i));
+}
+
+int main(int argc, char **argv) {
+	if(argc != 2) {
+		cerr << "ERROR: syntax: test-ext <ELF64 file>\n";
+		return 2;
+	}
+	try {
+		std::unique_ptr<elf::File> f(Manager::openELF(argv[1]));
+		if(f->toELF64() == nullptr) {
+			cout << "SKIPPED: not an ELF64 file" << io::endl;
+			return 0;
+		}
+		CHECK(f->sectionCount() > 1);
+
+		// move the section count and the name section index in section 0
+		std::ifstream in(argv[1], std::ios::binary);
+		std::vector<t::uint8> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		bool big = data[EI_DATA_OFF] == ELFDATA2MSB;
+		t::uint64 shoff = get(data, E_SHOFF_OFF, 8, big);
+		t::uint64 shnum = get(data, E_SHNUM_OFF, 2, big);
+		t::uint64 shstrndx = get(data, E_SHSTRNDX_OFF, 2, big);
+		put(data, E_SHNUM_OFF, 2, big, 0);
+		put(data, E_SHSTRNDX_OFF, 2, big, SHN_XINDEX);
+		put(data, shoff + SH_SIZE_OFF, 8, big, shnum);
+		put(data, shoff + SH_LINK_OFF, 4, big, shstrndx);
+
+		// the sections are the same
+		{
+			std::unique_ptr<gel::File> ef(Manager::DEFAULT.openMemory(&data[0], data.size()));
+			auto xf = ef->toELF();
+			CHECK(xf != nullptr);
+			if(xf != nullptr) {
+				CHECK(xf->sectionCount() == f->sectionCount());
+				for(int i = 0; i < xf->sectionCount() && i < f->sectionCount(); i++) {
+					CHECK(xf->sectionAt(i)->name() == f->sectionAt(i)->name());
+					CHECK(xf->sectionAt(i)->size() == f->sectionAt(i)->size());
+				}
+			}
+		}
+
+		// a count not fitting in an int is rejected
+		put(data, shoff + SH_SIZE_OFF, 8, big, (t::uint64(1) << 32) + 1);
+		bool raised = false;
+		try {
+			std::unique_ptr<gel::File> ef(Manager::DEFAULT.openMemory(&data[0], data.size()));
+			auto xf = ef->toELF();
+			if(xf != nullptr)
+				xf->sectionCount();
+		}
+		catch(gel::Exception& e) {
+			raised = true;
+		}
+		CHECK(raised);
+	}
+	catch(gel::Exception& e) {
+		cerr << "ERROR: " << e.message() << io::endl;
+		return 2;
+	}
+	return RESULT;
+}
@@ -0,0 +1,132 @@
+/*
+ * Check of the copy-on-write snapshots of Image
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <memory>
+#include <gel++/Image.h>
+#include <gel++/LittleDecoder.h>
+#include "check.h"
+
+using namespace elm;
+using namespace gel;
+
+static const size_t page = ImageSegment::page_size;
+static const address_t data_base = 0x10000, stack_base = 0x100000;
+
+// content of the data segment (the end of the segment is zero-filled)
+static const size_t data_size = 3 * page + 100;
+static t::uint8 data[data_size];
+
+// read a byte of an image
+static t::uint8 byteAt(Image& im, address_t a) {
+	t::uint8 b;
+	im.read(a, &b, 1);
+	return b;
+}
+
+int main(int argc, char **argv) {
+	for(size_t i = 0; i < data_size; i++)
+		data[i] = t::uint8(i * 7 + 1);
+	try {
+		Image im(nullptr);
+		im.add(new ImageSegment(nullptr, Buffer(&LittleDecoder::single, data, data_size),
+			data_base, 8 * page, ImageSegment::WRITABLE, "data"));
+		im.add(new ImageSegment(&LittleDecoder::single, stack_base, 16 * page,
+			ImageSegment::WRITABLE | ImageSegment::STACK, "stack"));
+		CHECK(im.dirtyPages().count() == 0);
+
+		// a fresh snapshot does not differ from its source
+		std::unique_ptr<Image> snap(im.snapshot());
+		CHECK(im.diff(*snap).count() == 0);
+		for(auto s: snap->segments())
+			CHECK(s->isShared());
+
+		// a write in the source is not seen by the snapshot
+		t::uint8 w[4];
+		for(int i = 0; i < 4; i++)
+			w[i] = ~data[10 + i];
+		im.write(data_base + 10, w, 4);
+		for(int i = 0; i < 4; i++) {
+			CHECK(byteAt(im, data_base + 10 + i) == w[i]);
+			CHECK(byteAt(*snap, data_base + 10 + i) == data[10 + i]);
+		}
+		CHECK(data[10] != w[0]);
+
+		// a write in the snapshot is not seen by the source
+		t::uint8 x = 0xa5;
+		address_t za = stack_base + 5 * page + 7;
+		snap->write(za, &x, 1);
+		CHECK(byteAt(*snap, za) == x);
+		CHECK(byteAt(im, za) == 0);
+		CHECK(im.at(za)->isZero(za - stack_base));
+		CHECK(!snap->at(za)->isZero(za - stack_base));
+
+		// each one lists its own dirty pages
+		auto dirty = im.dirtyPages();
+		CHECK(dirty.count() == 1 && dirty[0] == data_base);
+		auto sdirty = snap->dirtyPages();
+		CHECK(sdirty.count() == 1 && sdirty[0] == stack_base + 5 * page);
+
+		// a write across a page boundary dirties both pages
+		t::uint16 h = 0xffff;
+		im.write(data_base + page - 1, &h, 2);
+		dirty = im.dirtyPages();
+		CHECK(dirty.count() == 2 && dirty[0] == data_base && dirty[1] == data_base + page);
+		CHECK(im.at(data_base)->isDirty(page));
+		CHECK(!im.at(data_base)->isDirty(2 * page));
+		for(auto s: im.segments())
+			s->clearDirty();
+		CHECK(im.dirtyPages().count() == 0);
+		CHECK(snap->dirtyPages().count() == 1);
+
+		// the diff gives the differing bytes, in increasing order
+		auto d = im.diff(*snap);
+		CHECK(data[page - 1] != 0xff && data[page] != 0xff);
+		CHECK(d.count() == 3);
+		if(d.count() == 3) {
+			CHECK(d[0].base() == data_base + 10 && d[0].size() == 4);
+			CHECK(d[1].base() == data_base + page - 1 && d[1].size() == 2);
+			CHECK(d[2].base() == za && d[2].size() == 1);
+		}
+
+		// clearing the source keeps the dirty pages of its snapshots
+		im.write(data_base + 3 * page, w, 1);
+		std::unique_ptr<Image> snap3(im.snapshot());
+		for(auto s: im.segments())
+			s->clearDirty();
+		CHECK(im.dirtyPages().count() == 0);
+		dirty = snap3->dirtyPages();
+		CHECK(dirty.count() == 1 && dirty[0] == data_base + 3 * page);
+
+		// the zero-filled end of the data segment is still shared
+		CHECK(im.at(data_base)->isZero(6 * page));
+		CHECK(byteAt(im, data_base + 6 * page) == 0);
+
+		// the source survives its snapshot and conversely
+		std::unique_ptr<Image> snap2(snap->snapshot());
+		snap.reset();
+		CHECK(byteAt(*snap2, za) == x);
+		CHECK(byteAt(*snap2, data_base + 10) == data[10]);
+		CHECK(byteAt(im, data_base + 10) == w[0]);
+	}
+	catch(gel::Exception& e) {
+		cerr << "ERROR: " << e.message() << io::endl;
+		return 2;
+	}
+	return RESULT;
+}
@@ -0,0 +1,100 @@
+/*
+ * Check of the lazy decoding of DebugLine
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <memory>
+#include <gel++.h>
+#include <gel++/elf/DebugLine.h>
+#include "check.h"
+
+using namespace elm;
+using namespace gel;
+
+// count the loaded units
+static int loaded(const DebugLine& dl) {
+	int n = 0;
+	for(auto cu: dl.units())
+		if(cu->isLoaded())
+			n++;
+	return n;
+}
+
+int main(int argc, char **argv) {
+	if(argc != 2) {
+		cerr << "ERROR: syntax: test-lazy <ELF file with debug information>\n";
+		return 2;
+	}
+	try {
+		std::unique_ptr<elf::File> f(Manager::openELF(argv[1]));
+		std::unique_ptr<dwarf::DebugLine> eager(new dwarf::DebugLine(f.get(), false));
+		std::unique_ptr<dwarf::DebugLine> lazy(new dwarf::DebugLine(f.get(), true));
+		CHECK(eager->units().count() != 0);
+		CHECK(lazy->units().count() == eager->units().count());
+		CHECK(loaded(*lazy) == 0);
+
+		// the lines of an open file are decoded eagerly unless LAZY_LINES is given
+		std::unique_ptr<elf::File> ef(Manager::openELF(argv[1]));
+		CHECK(loaded(*ef->debugLines()) == eager->units().count());
+		std::unique_ptr<elf::File> lf(Manager::openELF(argv[1], Manager::LAZY_LINES));
+		CHECK(loaded(*lf->debugLines()) == 0);
+
+		// collect the code of the rows, marking the ones not overlapping others
+		Vector<interval_t> ints;
+		collectRows(*eager, ints);
+		CHECK(ints.count() != 0);
+		if(ints.count() == 0)
+			return RESULT;
+
+		// a first lookup only loads the units it needs
+		int k = 0;
+		while(k < ints.count() && !ints[k].alone)
+			k++;
+		CHECK(k < ints.count());
+		if(k < ints.count()) {
+			auto l = lazy->lineAt(ints[k].lo);
+			CHECK(l != nullptr && sameLine(*l, *eager->lineAt(ints[k].lo)));
+			CHECK(loaded(*lazy) >= 1);
+			if(lazy->units().count() > 1)
+				CHECK(loaded(*lazy) < lazy->units().count());
+		}
+
+		// lookups give the same rows as in eager mode
+		int step = max(1, ints.count() / max_lookups);
+		for(int i = 0; i < ints.count(); i += step)
+			if(ints[i].alone) {
+				address_t a = (ints[i].lo + ints[i].hi) / 2;
+				auto l = lazy->lineAt(a);
+				CHECK(l != nullptr && sameLine(*l, *eager->lineAt(a)));
+			}
+
+		// all the lines of the units are the same
+		for(int i = 0; i < eager->units().count(); i++) {
+			const auto& el = eager->units()[i]->lines();
+			const auto& ll = lazy->units()[i]->lines();
+			CHECK(el.count() == ll.count());
+			for(int j = 0; j < el.count() && j < ll.count(); j++)
+				CHECK(sameLine(el[j], ll[j]));
+		}
+		CHECK(loaded(*lazy) == lazy->units().count());
+	}
+	catch(gel::Exception& e) {
+		cerr << "ERROR: " << e.message() << io::endl;
+		return 2;
+	}
+	return RESULT;
+}
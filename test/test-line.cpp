@@ -0,0 +1,116 @@
+/*
+ * Check of DebugLine::lineAt() and DebugLine::linesIn()
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include <memory>
+#include <gel++.h>
+#include <gel++/elf/DebugLine.h>
+#include "check.h"
+
+using namespace elm;
+using namespace gel;
+
+// test if some row covers the address
+static bool covered(const Vector<interval_t>& ints, address_t a) {
+	for(const auto& i: ints)
+		if(i.lo <= a && a < i.hi)
+			return true;
+	return false;
+}
+
+// test if the given row covers the address
+static bool covers(const Vector<interval_t>& ints, const DebugLine::LineNumber *l, address_t a) {
+	for(const auto& i: ints)
+		if(i.line == l && i.lo <= a && a < i.hi)
+			return true;
+	return false;
+}
+
+int main(int argc, char **argv) {
+	if(argc != 2) {
+		cerr << "ERROR: syntax: test-line <ELF file with debug information>\n";
+		return 2;
+	}
+	try {
+		std::unique_ptr<elf::File> f(Manager::openELF(argv[1]));
+		std::unique_ptr<dwarf::DebugLine> dl(new dwarf::DebugLine(f.get(), false));
+		CHECK(dl->units().count() != 0);
+
+		// collect the code of the rows and the ends of sequences
+		Vector<interval_t> ints;
+		Vector<address_t> ends;
+		collectRows(*dl, ints, &ends);
+		CHECK(ints.count() != 0);
+		CHECK(ends.count() != 0);
+
+		// lineAt() finds a row covering the address, or nothing in the gaps
+		int step = max(1, ints.count() / max_lookups);
+		for(int i = 0; i < ints.count(); i += step)
+			for(address_t a: { ints[i].lo, (ints[i].lo + ints[i].hi) / 2, ints[i].hi - 1 }) {
+				auto l = dl->lineAt(a);
+				CHECK(l != nullptr && covers(ints, l, a));
+			}
+		step = max(1, ends.count() / max_lookups);
+		int gaps = 0;
+		for(int i = 0; i < ends.count(); i += step) {
+			auto l = dl->lineAt(ends[i]);
+			if(covered(ints, ends[i]))
+				CHECK(l != nullptr && covers(ints, l, ends[i]));
+			else {
+				CHECK(l == nullptr);
+				gaps++;
+			}
+		}
+		CHECK(gaps != 0);
+
+		// linesIn() provides, in address order, the rows intersecting the range
+		// (only checked on ranges without overlapping sequences)
+		int ranges = 0;
+		for(auto cu: dl->units()) {
+			address_t lo = cu->baseAddress(), hi = lo + (cu->topAddress() - lo) / 2 + 1;
+			Vector<interval_t> in;
+			for(const auto& i: ints)
+				if(i.lo < hi && lo < i.hi)
+					in.add(i);
+			if(in.count() != 0)
+				std::sort(&in[0], &in[0] + in.count(),
+					[](const interval_t& a, const interval_t& b) { return a.lo < b.lo; });
+			bool overlap = false;
+			for(int i = 1; i < in.count(); i++)
+				if(in[i].lo < in[i - 1].hi)
+					overlap = true;
+			if(overlap)
+				continue;
+			int n = 0;
+			for(auto i = dl->linesIn(lo, hi).begin(); !i.ended(); i.next()) {
+				CHECK(n < in.count() && i.item() == in[n].line);
+				CHECK(i.address() == in[n].lo && i.topAddress() == in[n].hi);
+				n++;
+			}
+			CHECK(n == in.count());
+			ranges++;
+		}
+		CHECK(ranges != 0);
+	}
+	catch(gel::Exception& e) {
+		cerr << "ERROR: " << e.message() << io::endl;
+		return 2;
+	}
+	return RESULT;
+}
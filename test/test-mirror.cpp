@@ -0,0 +1,138 @@
+/*
+ * Check of Mirror and of Mirror::guard()
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <gel++/Image.h>
+#include <gel++/LittleDecoder.h>
+#include <gel++/Mirror.h>
+#include "check.h"
+
+using namespace elm;
+using namespace gel;
+
+static const size_t page = ImageSegment::page_size;
+static const address_t code_base = 0x10000, data_base = 0x40000, hole = 0x80000000;
+
+static t::uint8 code[2 * page];
+
+// access performed under a guard
+typedef struct access_t {
+	Mirror *mirror;
+	address_t address;
+	bool write;
+	t::uint8 value;
+} access_t;
+
+static void touch(void *data) {
+	access_t *a = static_cast<access_t *>(data);
+	volatile t::uint8 *p = a->mirror->host(a->address);
+	if(a->write)
+		*p = a->value;
+	else
+		a->value = *p;
+}
+
+// throw from a guard
+static void throwing(void *data) {
+	throw gel::Exception("raised");
+}
+
+// fault in a guard after catching the exception of a nested guard
+static void nested(void *data) {
+	access_t *a = static_cast<access_t *>(data);
+	address_t fault;
+	try {
+		a->mirror->guard(throwing, nullptr, fault);
+	}
+	catch(gel::Exception&) {
+	}
+	touch(data);
+}
+
+int main(int argc, char **argv) {
+	if(!Mirror::isSupported()) {
+		cout << "mirror not supported: skipped" << io::endl;
+		return RESULT;
+	}
+	for(size_t i = 0; i < sizeof(code); i++)
+		code[i] = t::uint8(i * 13 + 5);
+	try {
+		Image im(nullptr);
+		im.add(new ImageSegment(nullptr, Buffer(&LittleDecoder::single, code, sizeof(code)),
+			code_base, ImageSegment::EXECUTABLE, "code"));
+		im.add(new ImageSegment(&LittleDecoder::single, data_base, 4 * page,
+			ImageSegment::WRITABLE, "data"));
+		Mirror m(im);
+
+		// the mirror gives the content of the image
+		bool same = true;
+		for(size_t i = 0; i < sizeof(code); i++)
+			if(*m.host(code_base + i) != code[i])
+				same = false;
+		CHECK(same);
+		CHECK(m.target(m.host(data_base)) == data_base);
+		CHECK(m.contains(m.host(hole)) && !m.contains(m.base() + Mirror::space));
+
+		// guarded accesses to the segments succeed
+		address_t fault = 0;
+		access_t a = { &m, code_base + 3, false, 0 };
+		CHECK(m.guard(touch, &a, fault) && a.value == code[3]);
+		a = { &m, data_base + 10, true, 0x5a };
+		CHECK(m.guard(touch, &a, fault));
+		a = { &m, data_base + 10, false, 0 };
+		CHECK(m.guard(touch, &a, fault) && a.value == 0x5a);
+
+		// the mirror is independent of the image
+		t::uint8 b;
+		im.read(data_base + 10, &b, 1);
+		CHECK(b == 0);
+
+		// a write in a read-only segment faults
+		a = { &m, code_base + 7, true, 0 };
+		CHECK(!m.guard(touch, &a, fault) && fault == code_base + 7);
+		CHECK(*m.host(code_base + 7) == code[7]);
+
+		// an access out of the segments faults
+		a = { &m, hole + 1, false, 0 };
+		CHECK(!m.guard(touch, &a, fault) && fault == hole + 1);
+
+		// an exception goes through the guard
+		bool raised = false;
+		try {
+			m.guard(throwing, nullptr, fault);
+		}
+		catch(gel::Exception&) {
+			raised = true;
+		}
+		CHECK(raised);
+
+		// after an exception in a nested guard, the faults go to the enclosing guard
+		a = { &m, hole + 2, false, 0 };
+		fault = 0;
+		CHECK(!m.guard(nested, &a, fault) && fault == hole + 2);
+
+		// the guards still work after all this
+		a = { &m, hole + 3, true, 1 };
+		CHECK(!m.guard(touch, &a, fault) && fault == hole + 3);
+	}
+	catch(gel::Exception& e) {
+		cerr << "ERROR: " << e.message() << io::endl;
+		return 2;
+	}
+	return RESULT;
+}
@@ -0,0 +1,80 @@
+/*
+ * Check of the parallel decoding of DebugLine
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <memory>
+#include <gel++.h>
+#include <gel++/elf/DebugLine.h>
+#include "check.h"
+
+using namespace elm;
+using namespace gel;
+
+// number of repeated parallel decodings
+static const int runs = 4;
+
+// compare the units and the files of two decodings
+static void compare(const DebugLine& dl1, const DebugLine& dl2) {
+	CHECK(dl1.units().count() == dl2.units().count());
+	for(int i = 0; i < dl1.units().count() && i < dl2.units().count(); i++) {
+		auto u1 = dl1.units()[i], u2 = dl2.units()[i];
+
+		const auto& f1 = u1->files(), f2 = u2->files();
+		CHECK(f1.count() == f2.count());
+		for(int j = 0; j < f1.count() && j < f2.count(); j++)
+			CHECK(f1[j]->path() == f2[j]->path());
+
+		const auto& l1 = u1->lines(), l2 = u2->lines();
+		CHECK(l1.count() == l2.count());
+		for(int j = 0; j < l1.count() && j < l2.count(); j++)
+			CHECK(sameLine(l1[j], l2[j]));
+	}
+
+	CHECK(dl1.files().count() == dl2.files().count());
+	for(auto f: dl1.files())
+		CHECK(dl2.files().hasKey(f->path()));
+}
+
+int main(int argc, char **argv) {
+	if(argc != 2) {
+		cerr << "ERROR: syntax: test-parallel <ELF file with debug information>\n";
+		return 2;
+	}
+	try {
+		std::unique_ptr<elf::File> f(Manager::openELF(argv[1]));
+
+		// the eager decoding runs the units in parallel
+		std::unique_ptr<dwarf::DebugLine> ref(new dwarf::DebugLine(f.get(), false));
+		CHECK(ref->units().count() != 0);
+		for(int i = 1; i < runs; i++) {
+			std::unique_ptr<dwarf::DebugLine> dl(new dwarf::DebugLine(f.get(), false));
+			compare(*ref, *dl);
+		}
+
+		// the lazy decoding, unit by unit and in reverse order, is sequential
+		std::unique_ptr<dwarf::DebugLine> seq(new dwarf::DebugLine(f.get(), true));
+		for(int i = seq->units().count() - 1; i >= 0; i--)
+			seq->units()[i]->lines();
+		compare(*ref, *seq);
+	}
+	catch(gel::Exception& e) {
+		cerr << "ERROR: " << e.message() << io::endl;
+		return 2;
+	}
+	return RESULT;
+}
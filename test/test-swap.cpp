@@ -0,0 +1,84 @@
+/*
+ * Check of SwapKernel against a plain byte swap
+ * Copyright (c) 2026, IRIT- université de Toulouse
+ *
+ * GEL++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * GEL++ is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GEL++; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <gel++/SwapKernel.h>
+#include "check.h"
+
+using namespace elm;
+using namespace gel;
+
+typedef SwapKernel::field_t field_t;
+
+// declare a kernel and its fields (SwapKernel does not give them back)
+#define LAYOUT(name, size, ...) \
+	static const field_t name##_f[] = { __VA_ARGS__ }; \
+	static const SwapKernel name(size, { __VA_ARGS__ });
+
+// record layouts of the ELF tables
+LAYOUT(sym32, 16, {0, 4}, {4, 4}, {8, 4}, {14, 2})
+LAYOUT(sym64, 24, {0, 4}, {6, 2}, {8, 8}, {16, 8})
+LAYOUT(rel32, 8, {0, 4}, {4, 4})
+LAYOUT(rela64, 24, {0, 8}, {8, 8}, {16, 8})
+LAYOUT(dyn64, 16, {0, 8}, {8, 8})
+LAYOUT(phdr32, 32, {0, 4}, {4, 4}, {8, 4}, {12, 4}, {16, 4}, {20, 4}, {24, 4}, {28, 4})
+LAYOUT(shdr64, 64, {0, 4}, {4, 4}, {8, 8}, {16, 8}, {24, 8}, {32, 8}, {40, 4}, {44, 4}, {48, 8}, {56, 8})
+
+// layout with a field crossing a vector lane (scalar only)
+LAYOUT(crossing, 12, {0, 4}, {4, 8})
+
+// reference swap, byte by byte
+static void swap(t::uint8 *buf, size_t n, t::uint32 size, const field_t *fields, int fcnt) {
+	for(size_t r = 0; r < n; r++, buf += size)
+		for(int i = 0; i < fcnt; i++)
+			std::reverse(buf + fields[i].offset, buf + fields[i].offset + fields[i].size);
+}
+
+// check a kernel on tables of different sizes and alignments
+template <int N>
+static void check(const SwapKernel& k, const field_t (&fields)[N]) {
+	static const size_t counts[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 17, 31, 64, 1000, 1001 };
+	static const size_t max_count = 1001, max_size = 64;
+	static t::uint8 buf[max_count * max_size + 1], ref[max_count * max_size + 1];
+	for(size_t c: counts)
+		for(size_t shift: { 0, 1 }) {
+			size_t s = c * k.size();
+			for(size_t i = 0; i < s; i++)
+				buf[shift + i] = ref[shift + i] = t::uint8(i * 31 + c);
+			k.apply(buf + shift, c);
+			swap(ref + shift, c, k.size(), fields, N);
+			CHECK(std::memcmp(buf + shift, ref + shift, s) == 0);
+		}
+}
+
+int main(int argc, char **argv) {
+	cout << "implementation: " << SwapKernel::implementation() << io::endl;
+	CHECK(sym64.isVector());
+	CHECK(!crossing.isVector());
+	check(sym32, sym32_f);
+	check(sym64, sym64_f);
+	check(rel32, rel32_f);
+	check(rela64, rela64_f);
+	check(dyn64, dyn64_f);
+	check(phdr32, phdr32_f);
+	check(shdr64, shdr64_f);
+	check(crossing, crossing_f);
+	return RESULT;
+}